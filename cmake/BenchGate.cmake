@@ -0,0 +1,55 @@
+# Compare instruction counts of the hashsig-bench workloads against a baseline,
+# run as a test with: cmake -DBENCH=... -DBASELINE=... -DTHRESHOLD=...
+# [-DVALGRIND=...] -DWORKDIR=... -P BenchGate.cmake
+#
+# Counts come from hardware performance counters. If those are unavailable
+# (e.g. in virtual machines or containers), each workload is run under callgrind
+# instead, collecting only inside bench_workload. Without either, or if the
+# baseline has no entries to compare against, the test prints
+# HASHSIG_BENCH_SKIPPED.
+
+file(STRINGS "${BASELINE}" BENCH_BASELINE_ENTRIES REGEX "^[^#]*[^# \t]")
+if (NOT BENCH_BASELINE_ENTRIES)
+	message("HASHSIG_BENCH_SKIPPED: ${BASELINE} has no entries, generate it with: hashsig-bench -c -w ${BASELINE}")
+	return()
+endif ()
+
+execute_process(COMMAND "${BENCH}" -c -b "${BASELINE}" -x "${THRESHOLD}" RESULT_VARIABLE BENCH_RESULT)
+if (BENCH_RESULT EQUAL 0)
+	return()
+elseif (NOT BENCH_RESULT EQUAL 77)
+	message(FATAL_ERROR "Instruction counts deviate from ${BASELINE}.")
+endif ()
+
+if (NOT VALGRIND)
+	message("HASHSIG_BENCH_SKIPPED: neither hardware performance counters nor valgrind are available.")
+	return()
+endif ()
+
+execute_process(COMMAND "${BENCH}" -c -l OUTPUT_VARIABLE BENCH_WORKLOADS RESULT_VARIABLE BENCH_RESULT)
+if (NOT BENCH_RESULT EQUAL 0)
+	message(FATAL_ERROR "Failed to list workloads.")
+endif ()
+string(REGEX REPLACE "\n$" "" BENCH_WORKLOADS "${BENCH_WORKLOADS}")
+string(REPLACE "\n" ";" BENCH_WORKLOADS "${BENCH_WORKLOADS}")
+
+set(BENCH_COUNTS "${WORKDIR}/hashsig-bench.counts")
+file(WRITE "${BENCH_COUNTS}" "# Instruction counts measured with callgrind\n")
+foreach (BENCH_WORKLOAD ${BENCH_WORKLOADS})
+	set(BENCH_OUT "${WORKDIR}/callgrind.${BENCH_WORKLOAD}")
+	execute_process(COMMAND "${VALGRIND}" --tool=callgrind "--callgrind-out-file=${BENCH_OUT}" --collect-atstart=no --toggle-collect=bench_workload "${BENCH}" -c -W "${BENCH_WORKLOAD}" RESULT_VARIABLE BENCH_RESULT OUTPUT_QUIET ERROR_QUIET)
+	if (NOT BENCH_RESULT EQUAL 0)
+		message(FATAL_ERROR "Failed to run workload ${BENCH_WORKLOAD} under callgrind.")
+	endif ()
+
+	# Older versions of callgrind write "summary:", newer ones "totals:".
+	file(STRINGS "${BENCH_OUT}" BENCH_TOTALS REGEX "^(summary|totals): [0-9]+")
+	list(GET BENCH_TOTALS 0 BENCH_TOTAL)
+	string(REGEX REPLACE "^[a-z]+: ([0-9]+).*$" "\\1" BENCH_TOTAL "${BENCH_TOTAL}")
+	file(APPEND "${BENCH_COUNTS}" "${BENCH_WORKLOAD} ${BENCH_TOTAL}\n")
+endforeach ()
+
+execute_process(COMMAND "${BENCH}" -c -i "${BENCH_COUNTS}" -b "${BASELINE}" -x "${THRESHOLD}" RESULT_VARIABLE BENCH_RESULT)
+if (NOT BENCH_RESULT EQUAL 0)
+	message(FATAL_ERROR "Instruction counts deviate from ${BASELINE}.")
+endif ()
@@ -0,0 +1,66 @@
+# Benchmark the Keccak-f[1600] permutation variants of KeccakF-1600-opt64.c on
+# the build machine and write the settings of the fastest one to
+# ${CMAKE_BINARY_DIR}/include/KeccakF-1600-opt64-tuned.h.
+#
+# The result is cached in HASHSIG_KECCAK_TUNED_SETTINGS. Remove it from the
+# cache to benchmark again. The winner may use instructions of the build
+# machine (BMI2 for UseRORX), so do not use this for portable binaries.
+
+set(HASHSIG_KECCAK_TUNED_HEADER "${CMAKE_BINARY_DIR}/include/KeccakF-1600-opt64-tuned.h")
+
+if (NOT DEFINED HASHSIG_KECCAK_TUNED_SETTINGS)
+	set(KECCAK_TUNE_ROTATES "none")
+	if ("${CMAKE_SYSTEM_PROCESSOR}" MATCHES "^(x86_64|AMD64|amd64)$" AND NOT MSVC)
+		list(APPEND KECCAK_TUNE_ROTATES UseSHLD UseRORX)
+	endif ()
+
+	set(KECCAK_TUNE_BEST "")
+	set(KECCAK_TUNE_BEST_TIME 0)
+	foreach (KECCAK_TUNE_UNROLLING 1 2 3 4 6 12 24)
+		foreach (KECCAK_TUNE_COMPLEMENTING ON OFF)
+			foreach (KECCAK_TUNE_ROTATE ${KECCAK_TUNE_ROTATES})
+				set(KECCAK_TUNE_DEFINITIONS "-DUnrolling=${KECCAK_TUNE_UNROLLING}")
+				if (KECCAK_TUNE_COMPLEMENTING)
+					list(APPEND KECCAK_TUNE_DEFINITIONS -DUseLaneComplementing)
+				endif ()
+				if (NOT "${KECCAK_TUNE_ROTATE}" STREQUAL "none")
+					list(APPEND KECCAK_TUNE_DEFINITIONS -D${KECCAK_TUNE_ROTATE})
+				endif ()
+
+				try_run(KECCAK_TUNE_RUN KECCAK_TUNE_COMPILE "${CMAKE_BINARY_DIR}/keccak-tune" "${HASHSIG_SOURCE_DIR}/src/keccak/KeccakF-1600-tune.c"
+					CMAKE_FLAGS "-DINCLUDE_DIRECTORIES=${HASHSIG_SOURCE_DIR}/src\;${HASHSIG_SOURCE_DIR}/src/keccak"
+					COMPILE_DEFINITIONS ${KECCAK_TUNE_DEFINITIONS}
+					RUN_OUTPUT_VARIABLE KECCAK_TUNE_TIME)
+
+				# Variants that fail to build or run on this machine are skipped.
+				if (KECCAK_TUNE_COMPILE AND "${KECCAK_TUNE_RUN}" STREQUAL "0")
+					string(STRIP "${KECCAK_TUNE_TIME}" KECCAK_TUNE_TIME)
+					message(STATUS "Keccak variant ${KECCAK_TUNE_DEFINITIONS}: ${KECCAK_TUNE_TIME} (0.1 ns/permutation)")
+					if ("${KECCAK_TUNE_BEST}" STREQUAL "" OR KECCAK_TUNE_TIME LESS KECCAK_TUNE_BEST_TIME)
+						set(KECCAK_TUNE_BEST "${KECCAK_TUNE_DEFINITIONS}")
+						set(KECCAK_TUNE_BEST_TIME ${KECCAK_TUNE_TIME})
+					endif ()
+				else ()
+					message(STATUS "Keccak variant ${KECCAK_TUNE_DEFINITIONS}: not available")
+				endif ()
+			endforeach ()
+		endforeach ()
+	endforeach ()
+
+	if ("${KECCAK_TUNE_BEST}" STREQUAL "")
+		message(FATAL_ERROR "No Keccak permutation variant could be benchmarked.")
+	endif ()
+	message(STATUS "Fastest Keccak variant: ${KECCAK_TUNE_BEST}")
+	set(HASHSIG_KECCAK_TUNED_SETTINGS "${KECCAK_TUNE_BEST}" CACHE STRING "Fastest Keccak permutation settings found by HASHSIG_KECCAK_AUTOTUNE.")
+endif ()
+
+# Turn -DName=Value into #define Name Value.
+set(KECCAK_TUNE_HEADER "// Generated by cmake/KeccakAutotune.cmake. Do not edit.\n")
+foreach (KECCAK_TUNE_DEFINITION ${HASHSIG_KECCAK_TUNED_SETTINGS})
+	string(REGEX REPLACE "^-D" "" KECCAK_TUNE_DEFINITION "${KECCAK_TUNE_DEFINITION}")
+	string(REPLACE "=" " " KECCAK_TUNE_DEFINITION "${KECCAK_TUNE_DEFINITION}")
+	set(KECCAK_TUNE_HEADER "${KECCAK_TUNE_HEADER}#define ${KECCAK_TUNE_DEFINITION}\n")
+endforeach ()
+file(WRITE "${HASHSIG_KECCAK_TUNED_HEADER}.tmp" "${KECCAK_TUNE_HEADER}")
+configure_file("${HASHSIG_KECCAK_TUNED_HEADER}.tmp" "${HASHSIG_KECCAK_TUNED_HEADER}" COPYONLY)
+add_definitions(-DHASHSIG_KECCAK_TUNED)
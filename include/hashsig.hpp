@@ -0,0 +1,553 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef HASHSIG_HPP
+#define HASHSIG_HPP
+
+/* Header-only C++20 interface to libhashsig. Contexts, keys and signatures are move-only owners, buffers are passed as spans and errors returned as expected values. Memory is taken from a std::pmr::memory_resource. */
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if __has_include(<expected>)
+#include <expected>
+#endif
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <cerrno>
+#include <coroutine>
+#include <unistd.h>
+#define HASHSIG_COROUTINES
+#endif
+
+#include "hashsig.h"
+
+namespace hashsig
+{
+  enum class Error
+  {
+    unsupported_type,
+    bad_length,
+    bad_signature,
+    allocation_failed,
+    io
+  };
+
+#if defined(__cpp_lib_expected) && __cpp_lib_expected >= 202202L
+  template <class T>
+  using Expected = std::expected<T, Error>;
+
+  inline std::unexpected<Error> unexpected (Error error)
+  {
+    return std::unexpected<Error>(error);
+  }
+#else
+  /* Minimal stand-in for std::expected before C++23. */
+  struct Unexpected
+  {
+    Error error;
+  };
+
+  inline Unexpected unexpected (Error error)
+  {
+    return Unexpected { error };
+  }
+
+  template <class T>
+  class Expected
+  {
+  public:
+    Expected (T &&value) : ok(true), val(std::move(value)) {}
+    Expected (Unexpected e) : ok(false), err(e.error) {}
+    Expected (Expected &&other) : ok(other.ok), err(other.err)
+    {
+      if (ok)
+        new (&val) T(std::move(other.val));
+    }
+    ~Expected ()
+    {
+      if (ok)
+        val.~T();
+    }
+
+    bool has_value () const { return ok; }
+    explicit operator bool () const { return ok; }
+    T &value () { return val; }
+    T &operator* () { return val; }
+    T *operator-> () { return &val; }
+    Error error () const { return err; }
+
+  private:
+    bool ok;
+    Error err = Error::unsupported_type;
+    union { T val; };
+  };
+
+  template <>
+  class Expected<void>
+  {
+  public:
+    Expected () : ok(true) {}
+    Expected (Unexpected e) : ok(false), err(e.error) {}
+
+    bool has_value () const { return ok; }
+    explicit operator bool () const { return ok; }
+    void value () const {}
+    Error error () const { return err; }
+
+  private:
+    bool ok;
+    Error err = Error::unsupported_type;
+  };
+#endif
+
+  using Bytes = std::span<const std::byte>;
+  using MutableBytes = std::span<std::byte>;
+
+  namespace detail
+  {
+    /* All allocations of libhashsig are aligned to at most a cache line. The resource needs the same alignment again when deallocating. */
+    constexpr std::size_t alignment = 64;
+
+    inline void *pmr_alloc (void *opaque, const size_t size, const size_t)
+    {
+      try
+      {
+        void *ptr = static_cast<std::pmr::memory_resource *>(opaque)->allocate(size, alignment);
+        std::memset(ptr, 0, size);
+        return ptr;
+      }
+      catch (...)
+      {
+        return nullptr;
+      }
+    }
+
+    inline void pmr_free (void *opaque, void *ptr, const size_t size)
+    {
+      static_cast<std::pmr::memory_resource *>(opaque)->deallocate(ptr, size, alignment);
+    }
+
+    inline hashsig_allocator_t allocator (std::pmr::memory_resource *resource)
+    {
+      return hashsig_allocator_t { pmr_alloc, pmr_free, resource };
+    }
+
+    inline const uint8_t *data (Bytes bytes)
+    {
+      return reinterpret_cast<const uint8_t *>(bytes.data());
+    }
+
+    inline uint8_t *data (MutableBytes bytes)
+    {
+      return reinterpret_cast<uint8_t *>(bytes.data());
+    }
+
+    /* Viewing a lone type byte as public key fails with a negative result only for unsupported types. */
+    inline bool supported (uint32_t type)
+    {
+      uint8_t buf[1] = { static_cast<uint8_t>(type) };
+      hashsig_pub_view_t view;
+
+      return type <= 0xff && hashsig_pub_view(&view, buf, sizeof(buf)) >= 0;
+    }
+  }
+
+  /* Serialized signature, allocated from a memory resource. */
+  class Signature
+  {
+  public:
+    explicit Signature (std::size_t len, std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : buf(len, resource) {}
+    Signature (Signature &&) = default;
+    Signature &operator= (Signature &&) = default;
+    Signature (const Signature &) = delete;
+    Signature &operator= (const Signature &) = delete;
+
+    Bytes bytes () const { return Bytes(buf.data(), buf.size()); }
+    MutableBytes bytes () { return MutableBytes(buf.data(), buf.size()); }
+    std::size_t size () const { return buf.size(); }
+
+  private:
+    std::pmr::vector<std::byte> buf;
+  };
+
+  /* Serialized public key. */
+  class PublicKey
+  {
+  public:
+    PublicKey () = default;
+    explicit PublicKey (Bytes bytes) : len(bytes.size() <= sizeof(buf) ? bytes.size() : 0)
+    {
+      std::memcpy(buf, bytes.data(), len);
+    }
+
+    Bytes bytes () const { return Bytes(buf, len); }
+
+  private:
+    std::byte buf[64] = {};
+    std::size_t len = 0;
+  };
+
+  class Key;
+
+  /* Context for signing on one thread at a time, drawn from the pool of a Key and returned to it when destroyed. */
+  class Signer
+  {
+  public:
+    Signer (Signer &&other) noexcept : ctx(std::exchange(other.ctx, nullptr)), resource(other.resource) {}
+    Signer &operator= (Signer &&other) noexcept
+    {
+      std::swap(ctx, other.ctx);
+      resource = other.resource;
+      return *this;
+    }
+    Signer (const Signer &) = delete;
+    Signer &operator= (const Signer &) = delete;
+    ~Signer ()
+    {
+      if (ctx != nullptr)
+        hashsig_key_release(ctx);
+    }
+
+    std::size_t signature_length () const { return hashsig_signature_length(ctx); }
+
+    /* Sign straight into caller memory. Returns the part of out holding the signature. */
+    Expected<MutableBytes> sign_into (Bytes message, MutableBytes out)
+    {
+      if (hashsig_sign_into(ctx, detail::data(message), message.size(), detail::data(out), out.size()))
+        return unexpected(Error::bad_length);
+      return out.first(signature_length());
+    }
+
+    Expected<Signature> sign (Bytes message)
+    {
+      Signature sig(signature_length(), resource);
+
+      hashsig_sign_into(ctx, detail::data(message), message.size(), detail::data(sig.bytes()), sig.size());
+      return sig;
+    }
+
+    /* Same signature, with the trees spread over executor or the default pool if it is nullptr. */
+    Expected<Signature> sign (Bytes message, const hashsig_executor_t *executor)
+    {
+      Signature sig(signature_length(), resource);
+
+      hashsig_sign_parallel(ctx, detail::data(message), message.size(), detail::data(sig.bytes()), sig.size(), executor);
+      return sig;
+    }
+
+    hashsig_t *get () const { return ctx; }
+
+  private:
+    friend class Key;
+    Signer (hashsig_t *c, std::pmr::memory_resource *r) : ctx(c), resource(r) {}
+
+    hashsig_t *ctx;
+    std::pmr::memory_resource *resource;
+  };
+
+  /* Private key shared between threads, with its public key calculated once. The private key is copied and zeroed on destruction. */
+  class Key
+  {
+  public:
+    static Expected<Key> create (uint32_t type, Bytes priv, std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+    {
+      if (!detail::supported(type))
+        return unexpected(Error::unsupported_type);
+      if (priv.size() != hashsig_private_key_length_type(type))
+        return unexpected(Error::bad_length);
+
+      Key key(priv, resource);
+
+      key.key = hashsig_create_key(type, reinterpret_cast<const uint8_t *>(key.priv.get()), key.priv_len, nullptr, &key.allocator);
+      if (key.key == nullptr)
+        return unexpected(Error::allocation_failed);
+      return key;
+    }
+
+    Key (Key &&other) noexcept : key(std::exchange(other.key, nullptr)), priv(std::move(other.priv)), priv_len(other.priv_len), allocator(other.allocator), resource(other.resource) {}
+    Key &operator= (Key &&other) noexcept
+    {
+      std::swap(key, other.key);
+      std::swap(priv, other.priv);
+      std::swap(priv_len, other.priv_len);
+      std::swap(allocator, other.allocator);
+      std::swap(resource, other.resource);
+      return *this;
+    }
+    Key (const Key &) = delete;
+    Key &operator= (const Key &) = delete;
+    ~Key ()
+    {
+      if (key != nullptr)
+        hashsig_destroy_key(key);
+      if (priv)
+      {
+        volatile std::byte *p = priv.get();
+        for (std::size_t i = 0; i < priv_len; i++)
+          p[i] = std::byte(0);
+      }
+    }
+
+    /* All signers have to be destroyed before the key. */
+    Expected<Signer> signer () const
+    {
+      hashsig_t *ctx = hashsig_key_acquire(key);
+
+      if (ctx == nullptr)
+        return unexpected(Error::allocation_failed);
+      return Signer(ctx, resource);
+    }
+
+    PublicKey public_key () const
+    {
+      std::byte buf[64];
+      Expected<Signer> s = signer();
+      hashsig_pub_t *pub;
+      std::size_t len;
+
+      if (!s)
+        return PublicKey();
+      pub = hashsig_get_public_key(s->get());
+      len = hashsig_public_key_length(s->get());
+      hashsig_pub2buf(pub, reinterpret_cast<uint8_t *>(buf), sizeof(buf));
+      hashsig_free(pub);
+      return PublicKey(Bytes(buf, len));
+    }
+
+    hashsig_key_t *get () const { return key; }
+
+  private:
+    Key (Bytes p, std::pmr::memory_resource *r) : key(nullptr), priv(new std::byte[p.size()]), priv_len(p.size()), allocator(detail::allocator(r)), resource(r)
+    {
+      std::memcpy(priv.get(), p.data(), p.size());
+    }
+
+    hashsig_key_t *key;
+    std::unique_ptr<std::byte[]> priv;
+    std::size_t priv_len;
+    hashsig_allocator_t allocator;
+    std::pmr::memory_resource *resource;
+  };
+
+  /* Incremental verification of a message and signature arriving in pieces. */
+  class StreamVerifier
+  {
+  public:
+    StreamVerifier (StreamVerifier &&other) noexcept : verifier(std::exchange(other.verifier, nullptr)) {}
+    StreamVerifier &operator= (StreamVerifier &&other) noexcept
+    {
+      std::swap(verifier, other.verifier);
+      return *this;
+    }
+    StreamVerifier (const StreamVerifier &) = delete;
+    StreamVerifier &operator= (const StreamVerifier &) = delete;
+    ~StreamVerifier ()
+    {
+      if (verifier != nullptr)
+        hashsig_verifier_free(verifier);
+    }
+
+    void message (Bytes data) { hashsig_verifier_message(verifier, detail::data(data), data.size()); }
+    Expected<void> signature (Bytes data) { return result(hashsig_verifier_signature(verifier, detail::data(data), data.size())); }
+    Expected<void> final () { return result(hashsig_verifier_final(verifier)); }
+
+    static Expected<void> result (int valid)
+    {
+      if (valid < 0)
+        return unexpected(Error::unsupported_type);
+      if (valid > 0)
+        return unexpected(Error::bad_signature);
+      return {};
+    }
+
+  private:
+    friend class Verifier;
+    explicit StreamVerifier (hashsig_verifier_t *v) : verifier(v) {}
+
+    hashsig_verifier_t *verifier;
+  };
+
+  /* Verification against one public key. */
+  class Verifier
+  {
+  public:
+    static Expected<Verifier> create (Bytes pub, std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+    {
+      Verifier verifier(pub, resource);
+      int valid = hashsig_pub_view(&verifier.view, detail::data(verifier.pub.bytes()), verifier.pub.bytes().size());
+
+      if (valid < 0)
+        return unexpected(Error::unsupported_type);
+      if (valid > 0)
+        return unexpected(Error::bad_length);
+      return verifier;
+    }
+
+    Verifier (Verifier &&other) noexcept : pub(other.pub), view(other.view), allocator(other.allocator)
+    {
+      view.data = detail::data(pub.bytes()) + 1;
+    }
+    Verifier &operator= (Verifier &&other) noexcept
+    {
+      pub = other.pub;
+      view = other.view;
+      view.data = detail::data(pub.bytes()) + 1;
+      allocator = other.allocator;
+      return *this;
+    }
+    Verifier (const Verifier &) = delete;
+    Verifier &operator= (const Verifier &) = delete;
+
+    Expected<void> verify (Bytes message, Bytes sig) const
+    {
+      hashsig_sig_view_t sig_view;
+      int valid = hashsig_sig_view(&sig_view, detail::data(sig), sig.size());
+
+      if (valid < 0)
+        return unexpected(Error::unsupported_type);
+      if (valid > 0)
+        return unexpected(Error::bad_length);
+      return StreamVerifier::result(hashsig_verify_view_alloc(&view, &sig_view, detail::data(message), message.size(), &allocator));
+    }
+
+    Expected<StreamVerifier> stream () const
+    {
+      hashsig_verifier_t *verifier = hashsig_verifier_create(&view);
+
+      if (verifier == nullptr)
+        return unexpected(Error::unsupported_type);
+      return StreamVerifier(verifier);
+    }
+
+  private:
+    Verifier (Bytes p, std::pmr::memory_resource *r) : pub(p), view(), allocator(detail::allocator(r)) {}
+
+    PublicKey pub;
+    hashsig_pub_view_t view;
+    hashsig_allocator_t allocator;
+  };
+
+#ifdef HASHSIG_COROUTINES
+  namespace detail
+  {
+    /* Awaitable running work on an executor. The awaiting coroutine is resumed on the thread finishing it, so hop back to the own scheduler afterwards if needed. If no executor takes the task, the work runs right away without suspending. */
+    template <class F>
+    class Offload
+    {
+    public:
+      using Result = std::invoke_result_t<F &>;
+
+      Offload (const hashsig_executor_t *e, F &&f) : executor(e != nullptr ? e : hashsig_pool_default()), work(std::move(f)) {}
+
+      bool await_ready () const noexcept { return false; }
+
+      bool await_suspend (std::coroutine_handle<> h)
+      {
+        const hashsig_executor_t *e = executor;
+
+        /* Once submitted, the awaitable may be gone already when submit returns. */
+        handle = h;
+        if (e != nullptr && e->submit(e->opaque, run, this) == 0)
+          return true;
+        result.emplace(work());
+        return false;
+      }
+
+      Result await_resume () { return std::move(*result); }
+
+    private:
+      static void run (void *arg)
+      {
+        Offload *self = static_cast<Offload *>(arg);
+
+        self->result.emplace(self->work());
+        self->handle.resume();
+      }
+
+      const hashsig_executor_t *executor;
+      F work;
+      std::optional<Result> result;
+      std::coroutine_handle<> handle;
+    };
+
+    template <class F>
+    Offload<F> offload (const hashsig_executor_t *executor, F &&f)
+    {
+      return Offload<F>(executor, std::move(f));
+    }
+  }
+
+  /* Awaitable signing on executor, or the default pool if it is nullptr, with the trees spread over it. signer and message have to stay valid until the coroutine is resumed. */
+  inline auto co_sign (Signer &signer, Bytes message, const hashsig_executor_t *executor = nullptr)
+  {
+    return detail::offload(executor, [&signer, message, executor] () { return signer.sign(message, executor); });
+  }
+
+  /* Awaitable verification on executor, or the default pool if it is nullptr. */
+  inline auto co_verify (const Verifier &verifier, Bytes message, Bytes sig, const hashsig_executor_t *executor = nullptr)
+  {
+    return detail::offload(executor, [&verifier, message, sig] () { return verifier.verify(message, sig); });
+  }
+
+  /* Awaitable signing of everything left to read from fd. Reading happens on the executor as well, so the awaiting thread never blocks on the file. */
+  inline auto co_sign_file (Signer &signer, int fd, const hashsig_executor_t *executor = nullptr)
+  {
+    return detail::offload(executor, [&signer, fd, executor] () -> Expected<Signature>
+    {
+      std::vector<std::byte> message;
+      std::size_t len = 0;
+
+      for (;;)
+      {
+        ssize_t got;
+
+        if (message.size() - len < 65536)
+          message.resize(message.size() + 65536);
+        if ((got = ::read(fd, message.data() + len, message.size() - len)) == 0)
+          break;
+        if (got < 0 && errno != EINTR)
+          return unexpected(Error::io);
+        if (got > 0)
+          len += got;
+      }
+
+      return signer.sign(Bytes(message.data(), len), executor);
+    });
+  }
+#endif
+}
+
+#endif /* HASHSIG_HPP */
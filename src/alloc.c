@@ -0,0 +1,265 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Memory allocation */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define HASHSIG_HAVE_MMAN
+#endif
+
+#include "hashsig.h"
+#include "util.h"
+
+/* Every buffer from hashsig_calloc starts with a header holding its size, as hashsig_free does not know it. */
+#define HASHSIG_ALLOC_HEADER 16
+
+/* Smallest allocation to back with huge pages. */
+#define HASHSIG_HUGEPAGE_MIN (64 * 1024)
+#define HASHSIG_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+static void *hashsig_default_alloc (void *opaque, const size_t size, const size_t align)
+{
+  void *ptr;
+
+  if (align <= HASHSIG_ALLOC_HEADER)
+    return calloc(1, size);
+
+  if (posix_memalign(&ptr, align, size))
+    return NULL;
+  memset(ptr, 0, size);
+  return ptr;
+}
+
+static void hashsig_default_free (void *opaque, void *ptr, const size_t size)
+{
+  free(ptr);
+}
+
+static hashsig_allocator_t hashsig_global_allocator = { hashsig_default_alloc, hashsig_default_free, NULL };
+
+void hashsig_set_allocator (const hashsig_allocator_t *allocator)
+{
+  if (allocator != NULL)
+    hashsig_global_allocator = *allocator;
+  else
+  {
+    hashsig_global_allocator.alloc = hashsig_default_alloc;
+    hashsig_global_allocator.free = hashsig_default_free;
+    hashsig_global_allocator.opaque = NULL;
+  }
+}
+
+const hashsig_allocator_t *hashsig_current_allocator (void)
+{
+  return &hashsig_global_allocator;
+}
+
+/* Allocation of zeroed memory. Fails hard if allocator is NULL and the global allocator is used, otherwise returns NULL on failure. */
+void *hashsig_alloc (const hashsig_allocator_t *allocator, const size_t size, const size_t align)
+{
+  const hashsig_allocator_t *a = (allocator != NULL) ? allocator : &hashsig_global_allocator;
+  void *buf = a->alloc(a->opaque, size, align);
+
+  if (buf == NULL && allocator == NULL)
+  {
+    fprintf(stderr, "Failed to allocate memory.");
+    abort();
+  }
+  return buf;
+}
+
+void hashsig_dealloc (const hashsig_allocator_t *allocator, void *buf, const size_t size)
+{
+  const hashsig_allocator_t *a = (allocator != NULL) ? allocator : &hashsig_global_allocator;
+
+  if (buf != NULL)
+    a->free(a->opaque, buf, size);
+}
+
+/* Failing calloc. */
+void *hashsig_calloc (size_t nmemb, size_t size)
+{
+  uint8_t *buf;
+
+  if (size != 0 && nmemb > (SIZE_MAX - HASHSIG_ALLOC_HEADER) / size)
+  {
+    fprintf(stderr, "Failed to allocate memory.");
+    abort();
+  }
+
+  size = nmemb * size + HASHSIG_ALLOC_HEADER;
+  buf = hashsig_alloc(NULL, size, HASHSIG_ALLOC_HEADER);
+  memcpy(buf, &size, sizeof(size));
+
+  return buf + HASHSIG_ALLOC_HEADER;
+}
+
+void hashsig_free (void *buf)
+{
+  size_t size;
+
+  if (buf == NULL)
+    return;
+
+  buf = (uint8_t *)buf - HASHSIG_ALLOC_HEADER;
+  memcpy(&size, buf, sizeof(size));
+  hashsig_dealloc(NULL, buf, size);
+}
+
+/* Bump arena */
+
+static void *hashsig_arena_alloc (void *opaque, const size_t size, const size_t align)
+{
+  hashsig_arena_t *arena = opaque;
+  const uintptr_t start = (uintptr_t)arena->buf;
+  const uintptr_t ptr = (start + arena->used + align - 1) & ~(uintptr_t)(align - 1);
+
+  if (ptr - start > arena->size || size > arena->size - (ptr - start))
+    return NULL;
+
+  arena->used = ptr - start + size;
+  memset((void *)ptr, 0, size);
+
+  return (void *)ptr;
+}
+
+static void hashsig_arena_free (void *opaque, void *ptr, const size_t size)
+{
+}
+
+void hashsig_arena_init (hashsig_arena_t *arena, void *buf, const size_t size)
+{
+  arena->buf = buf;
+  arena->size = size;
+  arena->used = 0;
+}
+
+void hashsig_arena_allocator (hashsig_arena_t *arena, hashsig_allocator_t *allocator)
+{
+  allocator->alloc = hashsig_arena_alloc;
+  allocator->free = hashsig_arena_free;
+  allocator->opaque = arena;
+}
+
+void hashsig_arena_reset (hashsig_arena_t *arena)
+{
+  arena->used = 0;
+}
+
+/* Huge pages */
+
+#ifdef HASHSIG_HAVE_MMAN
+static size_t hashsig_hugepage_length (const size_t size)
+{
+  return (size + HASHSIG_HUGEPAGE_SIZE - 1) & ~(size_t)(HASHSIG_HUGEPAGE_SIZE - 1);
+}
+
+/* Map len bytes aligned to a huge page, so that transparent huge pages can back them. */
+static void *hashsig_hugepage_map (const size_t len)
+{
+  uint8_t *buf, *aligned;
+  size_t head;
+
+#ifdef MAP_HUGETLB
+  buf = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (buf != MAP_FAILED)
+    return buf;
+#endif
+
+  buf = mmap(NULL, len + HASHSIG_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buf == MAP_FAILED)
+    return NULL;
+
+  aligned = (uint8_t *)(((uintptr_t)buf + HASHSIG_HUGEPAGE_SIZE - 1) & ~(uintptr_t)(HASHSIG_HUGEPAGE_SIZE - 1));
+  head = aligned - buf;
+  if (head)
+    munmap(buf, head);
+  munmap(aligned + len, HASHSIG_HUGEPAGE_SIZE - head);
+
+#ifdef MADV_HUGEPAGE
+  madvise(aligned, len, MADV_HUGEPAGE);
+#endif
+
+  return aligned;
+}
+#endif
+
+static void *hashsig_hugepage_alloc (void *opaque, const size_t size, const size_t align)
+{
+#ifdef HASHSIG_HAVE_MMAN
+  const int flags = (int)(uintptr_t)opaque;
+  const size_t len = hashsig_hugepage_length(size);
+  void *buf;
+
+  if (size < HASHSIG_HUGEPAGE_MIN || align > HASHSIG_HUGEPAGE_SIZE)
+    return hashsig_default_alloc(NULL, size, align);
+
+  /* Anonymous mappings are zeroed. */
+  if ((buf = hashsig_hugepage_map(len)) == NULL)
+    return NULL;
+
+  if ((flags & HASHSIG_HUGEPAGE_MLOCK) && mlock(buf, len))
+  {
+    munmap(buf, len);
+    return NULL;
+  }
+
+  return buf;
+#else
+  return hashsig_default_alloc(NULL, size, align);
+#endif
+}
+
+static void hashsig_hugepage_free (void *opaque, void *ptr, const size_t size)
+{
+#ifdef HASHSIG_HAVE_MMAN
+  if (size >= HASHSIG_HUGEPAGE_MIN)
+  {
+    /* Unmapping also unlocks. */
+    munmap(ptr, hashsig_hugepage_length(size));
+    return;
+  }
+#endif
+  free(ptr);
+}
+
+void hashsig_hugepage_allocator (hashsig_allocator_t *allocator, const int flags)
+{
+  allocator->alloc = hashsig_hugepage_alloc;
+  allocator->free = hashsig_hugepage_free;
+  allocator->opaque = (void *)(uintptr_t)flags;
+}
@@ -0,0 +1,197 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Asynchronous signing */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <string.h>
+#ifdef HASHSIG_THREADS
+#include <pthread.h>
+#endif
+
+#include "hashsig_defs.h"
+#include "hashsig.h"
+#include "lmfs_defs.h"
+#include "util.h"
+#include "trace.h"
+#include "executor.h"
+
+struct hashsig_job_s
+{
+  hashsig_t *ctx;
+  const uint8_t *message;
+  size_t len;
+  uint8_t *sig;
+  void (*callback) (void *user, const int status, const uint8_t *sig, const size_t sig_len);
+  void (*progress) (void *user, const size_t trees, const size_t total);
+  void *user;
+  volatile int cancel;
+  int status;
+#ifdef HASHSIG_THREADS
+  pthread_mutex_t lock;
+  pthread_cond_t finished;
+#endif
+};
+
+/* Report progress and tell signing to stop if cancelled. */
+static int hashsig_job_tree_done (void *arg, const size_t trees)
+{
+  hashsig_job_t *job = arg;
+
+  if (job->progress != NULL)
+    job->progress(job->user, trees, LMFS_TREES);
+
+  return job->cancel;
+}
+
+static void hashsig_job_run (void *arg)
+{
+  hashsig_job_t *job = arg;
+  int status = HASHSIG_JOB_CANCELLED;
+
+  if (!job->cancel)
+  {
+    HASHSIG_TRACE_BEGIN(sign, job->len);
+    if (!hashsig_lmfs_sign(job->ctx, job->sig, job->message, job->len, hashsig_job_tree_done, job))
+      status = HASHSIG_JOB_DONE;
+    HASHSIG_TRACE_END(sign, job->len);
+  }
+
+  if (job->callback != NULL)
+  {
+    if (status == HASHSIG_JOB_DONE)
+      job->callback(job->user, status, job->sig, hashsig_signature_length(job->ctx));
+    else
+      job->callback(job->user, status, NULL, 0);
+  }
+
+#ifdef HASHSIG_THREADS
+  pthread_mutex_lock(&job->lock);
+  job->status = status;
+  pthread_cond_broadcast(&job->finished);
+  pthread_mutex_unlock(&job->lock);
+#else
+  job->status = status;
+#endif
+}
+
+hashsig_job_t *hashsig_sign_async (hashsig_t *ctx, const uint8_t *message, const size_t len, void (*callback) (void *user, const int status, const uint8_t *sig, const size_t sig_len), void *user)
+{
+  return hashsig_sign_async_executor(ctx, message, len, callback, NULL, user, NULL);
+}
+
+hashsig_job_t *hashsig_sign_async_executor (hashsig_t *ctx, const uint8_t *message, const size_t len, void (*callback) (void *user, const int status, const uint8_t *sig, const size_t sig_len), void (*progress) (void *user, const size_t trees, const size_t total), void *user, const hashsig_executor_t *executor)
+{
+  hashsig_job_t *job;
+
+  hashsig_assert_ctx(ctx);
+
+  job = hashsig_calloc(1, sizeof(hashsig_job_t));
+  job->ctx = ctx;
+  job->message = message;
+  job->len = len;
+  job->sig = hashsig_calloc(1, hashsig_signature_length(ctx));
+  job->callback = callback;
+  job->progress = progress;
+  job->user = user;
+  job->status = HASHSIG_JOB_PENDING;
+#ifdef HASHSIG_THREADS
+  pthread_mutex_init(&job->lock, NULL);
+  pthread_cond_init(&job->finished, NULL);
+#endif
+
+  /* Without an executor, or if it does not accept the job, sign right away. */
+  executor = hashsig_executor(executor);
+  if (executor == NULL || executor->submit(executor->opaque, hashsig_job_run, job))
+    hashsig_job_run(job);
+
+  return job;
+}
+
+int hashsig_job_poll (hashsig_job_t *job)
+{
+  int status;
+
+#ifdef HASHSIG_THREADS
+  pthread_mutex_lock(&job->lock);
+  status = job->status;
+  pthread_mutex_unlock(&job->lock);
+#else
+  status = job->status;
+#endif
+
+  return status;
+}
+
+int hashsig_job_wait (hashsig_job_t *job)
+{
+  int status;
+
+#ifdef HASHSIG_THREADS
+  pthread_mutex_lock(&job->lock);
+  while (job->status == HASHSIG_JOB_PENDING)
+    pthread_cond_wait(&job->finished, &job->lock);
+  status = job->status;
+  pthread_mutex_unlock(&job->lock);
+#else
+  status = job->status;
+#endif
+
+  return status;
+}
+
+void hashsig_job_cancel (hashsig_job_t *job)
+{
+  job->cancel = 1;
+  __sync_synchronize();
+}
+
+const uint8_t *hashsig_job_signature (hashsig_job_t *job, size_t *len)
+{
+  if (hashsig_job_poll(job) != HASHSIG_JOB_DONE)
+    return NULL;
+
+  *len = hashsig_signature_length(job->ctx);
+  return job->sig;
+}
+
+void hashsig_job_free (hashsig_job_t *job)
+{
+  hashsig_job_cancel(job);
+  hashsig_job_wait(job);
+
+#ifdef HASHSIG_THREADS
+  pthread_cond_destroy(&job->finished);
+  pthread_mutex_destroy(&job->lock);
+#endif
+  hashsig_free(job->sig);
+  hashsig_free(job);
+}
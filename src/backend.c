@@ -0,0 +1,194 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Hash function backends */
+
+#include "backend.h"
+#include "keccak.h"
+#include "sha256.h"
+#include "util.h"
+
+static void hashsig_backend_keccak_prepare_hash (void *ctx, const size_t len, const uint8_t *nonce, const size_t nonce_len)
+{
+  hashsig_keccak_prepare_hash(ctx, len, nonce, nonce_len);
+}
+
+static void hashsig_backend_keccak_hash (void *ctx, uint8_t *out, const uint8_t *in, const size_t len)
+{
+  hashsig_keccak_hash(ctx, out, in, len);
+}
+
+static void hashsig_backend_keccak_stream (void *ctx, uint8_t *out, size_t len, const uint8_t *key, size_t key_len, const uint8_t *nonce, size_t nonce_len)
+{
+  hashsig_keccak_stream(ctx, out, len, key, key_len, nonce, nonce_len);
+}
+
+static void hashsig_backend_keccak_sighash_init (void *ctx, size_t len, const uint8_t *pub, size_t pub_len)
+{
+  hashsig_keccak_sighash_init(ctx, len, pub, pub_len);
+}
+
+static void hashsig_backend_keccak_sighash_update (void *ctx, const uint8_t *msg, size_t msg_len)
+{
+  hashsig_keccak_sighash_update(ctx, msg, msg_len);
+}
+
+static void hashsig_backend_keccak_sighash_final (void *ctx, uint8_t *out)
+{
+  hashsig_keccak_sighash_final(ctx, out);
+}
+
+static void hashsig_backend_turboshake_prepare_hash (void *ctx, const size_t len, const uint8_t *nonce, const size_t nonce_len)
+{
+  hashsig_turboshake_prepare_hash(ctx, len, nonce, nonce_len);
+}
+
+static void hashsig_backend_turboshake_stream (void *ctx, uint8_t *out, size_t len, const uint8_t *key, size_t key_len, const uint8_t *nonce, size_t nonce_len)
+{
+  hashsig_turboshake_stream(ctx, out, len, key, key_len, nonce, nonce_len);
+}
+
+static void hashsig_backend_turboshake_sighash_init (void *ctx, size_t len, const uint8_t *pub, size_t pub_len)
+{
+  hashsig_turboshake_sighash_init(ctx, len, pub, pub_len);
+}
+
+static void hashsig_backend_sha256_prepare_hash (void *ctx, const size_t len, const uint8_t *nonce, const size_t nonce_len)
+{
+  hashsig_sha256_prepare_hash(ctx, len, nonce, nonce_len);
+}
+
+static void hashsig_backend_sha256_hash (void *ctx, uint8_t *out, const uint8_t *in, const size_t len)
+{
+  hashsig_sha256_hash(ctx, out, in, len);
+}
+
+static void hashsig_backend_sha256_hash_multi (void *ctx, uint8_t *out[], const uint8_t *const in[], const size_t len)
+{
+  hashsig_sha256_hash_x8(ctx, out, in, len);
+}
+
+static void hashsig_backend_sha256_stream (void *ctx, uint8_t *out, size_t len, const uint8_t *key, size_t key_len, const uint8_t *nonce, size_t nonce_len)
+{
+  hashsig_sha256_stream(ctx, out, len, key, key_len, nonce, nonce_len);
+}
+
+static void hashsig_backend_sha256_sighash_init (void *ctx, size_t len, const uint8_t *pub, size_t pub_len)
+{
+  hashsig_sha256_sighash_init(ctx, len, pub, pub_len);
+}
+
+static void hashsig_backend_sha256_sighash_update (void *ctx, const uint8_t *msg, size_t msg_len)
+{
+  hashsig_sha256_update(ctx, msg, msg_len);
+}
+
+static void hashsig_backend_sha256_sighash_final (void *ctx, uint8_t *out)
+{
+  hashsig_sha256_final(ctx, out);
+}
+
+static const hashsig_backend_t hashsig_backend_keccak =
+{
+  HASHSIG_FAMILY_KECCAK,
+  sizeof(keccak_ctx_t),
+  1,
+  hashsig_backend_keccak_prepare_hash,
+  hashsig_backend_keccak_hash,
+  NULL,
+  hashsig_keccak_sighash,
+  hashsig_backend_keccak_stream,
+  hashsig_backend_keccak_sighash_init,
+  hashsig_backend_keccak_sighash_update,
+  hashsig_backend_keccak_sighash_final
+};
+
+/* The hash function is shared with Keccak, since the number of rounds is part of the prepared context. */
+static const hashsig_backend_t hashsig_backend_turboshake =
+{
+  HASHSIG_FAMILY_TURBOSHAKE,
+  sizeof(keccak_ctx_t),
+  1,
+  hashsig_backend_turboshake_prepare_hash,
+  hashsig_backend_keccak_hash,
+  NULL,
+  hashsig_turboshake_sighash,
+  hashsig_backend_turboshake_stream,
+  hashsig_backend_turboshake_sighash_init,
+  hashsig_backend_keccak_sighash_update,
+  hashsig_backend_keccak_sighash_final
+};
+
+/* Used with SHA-NI, which is faster one message at a time than eight lanes with AVX2. */
+static const hashsig_backend_t hashsig_backend_sha256 =
+{
+  HASHSIG_FAMILY_SHA256,
+  sizeof(sha256_ctx_t),
+  1,
+  hashsig_backend_sha256_prepare_hash,
+  hashsig_backend_sha256_hash,
+  NULL,
+  hashsig_sha256_sighash,
+  hashsig_backend_sha256_stream,
+  hashsig_backend_sha256_sighash_init,
+  hashsig_backend_sha256_sighash_update,
+  hashsig_backend_sha256_sighash_final
+};
+
+static const hashsig_backend_t hashsig_backend_sha256_x8 =
+{
+  HASHSIG_FAMILY_SHA256,
+  sizeof(sha256_ctx_t),
+  8,
+  hashsig_backend_sha256_prepare_hash,
+  hashsig_backend_sha256_hash,
+  hashsig_backend_sha256_hash_multi,
+  hashsig_sha256_sighash,
+  hashsig_backend_sha256_stream,
+  hashsig_backend_sha256_sighash_init,
+  hashsig_backend_sha256_sighash_update,
+  hashsig_backend_sha256_sighash_final
+};
+
+const hashsig_backend_t *hashsig_backend (const uint32_t type)
+{
+  switch (type & HASHSIG_FAMILY_MASK)
+  {
+    case HASHSIG_FAMILY_KECCAK:
+      return &hashsig_backend_keccak;
+    case HASHSIG_FAMILY_SHA256:
+      if (hashsig_cpu_supports(HASHSIG_CPU_SHA))
+        return &hashsig_backend_sha256;
+      return &hashsig_backend_sha256_x8;
+    case HASHSIG_FAMILY_TURBOSHAKE:
+      return &hashsig_backend_turboshake;
+    default:
+      return NULL;
+  }
+}
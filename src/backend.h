@@ -0,0 +1,65 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Hash function families, selected by the upper bits of the type. */
+#define HASHSIG_FAMILY_MASK       0xe0
+#define HASHSIG_FAMILY_KECCAK     0x00
+#define HASHSIG_FAMILY_SKEIN      0x20
+#define HASHSIG_FAMILY_SHA256     0x40
+#define HASHSIG_FAMILY_TURBOSHAKE 0x60
+
+/* Maximum number of lanes of any multi-lane hash function. */
+#define HASHSIG_MAX_LANES 8
+
+/* Personalized hash functions used by LDWM and LMFS. The context is of ctx_size bytes and belongs to the libhashsig context. If lanes is greater than one, hash_multi hashes that many messages of equal length at once. Outputs may overlap their inputs. sighash_init, sighash_update and sighash_final calculate sighash incrementally in a separate context of ctx_size bytes. */
+typedef struct
+{
+  uint8_t family;
+  size_t ctx_size;
+  size_t lanes;
+  void (*prepare_hash) (void *ctx, const size_t len, const uint8_t *nonce, const size_t nonce_len);
+  void (*hash) (void *ctx, uint8_t *out, const uint8_t *in, const size_t len);
+  void (*hash_multi) (void *ctx, uint8_t *out[], const uint8_t *const in[], const size_t len);
+  void (*sighash) (uint8_t *out, size_t len, const uint8_t *pub, size_t pub_len, const uint8_t *msg, size_t msg_len);
+  void (*stream) (void *ctx, uint8_t *out, size_t len, const uint8_t *key, size_t key_len, const uint8_t *nonce, size_t nonce_len);
+  void (*sighash_init) (void *ctx, size_t len, const uint8_t *pub, size_t pub_len);
+  void (*sighash_update) (void *ctx, const uint8_t *msg, size_t msg_len);
+  void (*sighash_final) (void *ctx, uint8_t *out);
+} hashsig_backend_t;
+
+/* Returns the backend for the hash function family of the given type, or NULL if it is not supported. */
+const hashsig_backend_t *hashsig_backend (const uint32_t type);
+
+#endif /* BACKEND_H */
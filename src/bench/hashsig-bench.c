@@ -0,0 +1,820 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Benchmark program
+ *
+ * Measures the building blocks of libhashsig (Keccak permutation, hash
+ * function, LDWM hash chains, LMFS trees) and the end-to-end operations
+ * (key generation, signing, verification) for one type. For every benchmark,
+ * the median (p50) and 99th percentile (p99) time per call over a number of
+ * samples are reported. Rates are derived from the median, which is less
+ * sensitive to noise than the mean and makes runs on different commits
+ * comparable. Afterwards, the throughput of one operation is measured with 1
+ * up to N threads, each using its own context.
+ *
+ * With -c, fixed workloads are run once each instead and their instruction and
+ * cycle counts are taken from hardware performance counters. Unlike times,
+ * instruction counts are deterministic, so they can be compared against a
+ * baseline file (-b) to catch small regressions on noisy machines. If no
+ * counters are available, the program exits with BENCH_SKIP. The counts can
+ * then be measured externally, e.g. with callgrind on single workloads run with
+ * -W, and passed in with -i. See cmake/BenchGate.cmake. */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include "hashsig.h"
+#include "hashsig_defs.h"
+#include "backend.h"
+#include "ldwm_defs.h"
+#include "lmfs_defs.h"
+#include "KeccakF-1600-interface.h"
+
+#define BENCH_MAX_RESULTS 8
+#define BENCH_MAX_RUNS 32
+#define BENCH_MSG_LEN 120
+#define BENCH_MIN_SAMPLE_NS 1000000.0 /* Fast functions are called in batches taking at least this long. */
+#define BENCH_SKIP 77 /* Exit status if hardware counters are unavailable, as understood by ctest. */
+
+typedef struct
+{
+  uint32_t type;
+  uint8_t priv[64];
+  uint8_t msg[BENCH_MSG_LEN];
+  hashsig_t *ctx;
+  hashsig_pub_t *pub;
+  hashsig_sig_t *sig;
+  uint8_t state[200] __attribute__ ((aligned(32)));
+  uint8_t buf[LDWM_SIG_LEN];
+  uint8_t hash[LMFS_HASH_BYTES];
+} bench_t;
+
+typedef struct
+{
+  const char *name;
+  const char *unit; /* What is counted by the rate. */
+  double units;     /* Units per call. */
+  size_t samples;
+  size_t batch;
+  double p50;       /* Nanoseconds per call. */
+  double p99;
+  double rate;      /* Units per second at p50. */
+} bench_result_t;
+
+typedef struct
+{
+  size_t threads;
+  double rate;      /* Operations per second, summed over all threads. */
+} bench_run_t;
+
+typedef struct
+{
+  const char *name;
+  void (*fn) (bench_t *);
+  size_t calls;
+  uint64_t instructions;
+  uint64_t cycles;
+  uint64_t baseline;
+} bench_count_t;
+
+typedef struct
+{
+  bench_t *b;
+  const char *op;
+  double seconds;
+  size_t ops;
+  double elapsed;
+} bench_thread_t;
+
+static double now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_double (const void *a, const void *b)
+{
+  const double x = *(const double *)a, y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+/* Nearest rank percentile of sorted values. */
+static double percentile (const double *sorted, const size_t n, const double p)
+{
+  size_t rank = (size_t)ceil(p * n);
+
+  if (rank < 1)
+    rank = 1;
+  return sorted[rank - 1];
+}
+
+/* Benchmarked functions */
+
+static void run_perm (bench_t *b)
+{
+  hashsig_KeccakF1600_StatePermute(b->state);
+}
+
+static void run_perm12 (bench_t *b)
+{
+  hashsig_KeccakP1600_12rounds_StatePermute(b->state);
+}
+
+static void run_hash (bench_t *b)
+{
+  b->ctx->backend->hash(b->ctx->hash_ctx, b->buf, b->buf, LDWM_N);
+}
+
+static void run_chains (bench_t *b)
+{
+  hashsig_ldwm_chains(b->ctx, b->buf, NULL, LDWM_2_POW_W_MINUS_1, LDWM_P);
+}
+
+static void run_lmfs_tree (bench_t *b)
+{
+  uint8_t root[LDWM_N];
+
+  hashsig_lmfs_tree(b->ctx, b->hash, 0, root, NULL, NULL, NULL, NULL);
+}
+
+static void run_keygen (bench_t *b)
+{
+  hashsig_destroy_context(hashsig_create_context_type(b->type, b->priv, hashsig_private_key_length_type(b->type), NULL));
+}
+
+static void run_sign (bench_t *b)
+{
+  hashsig_free(hashsig_sign(b->ctx, b->msg, BENCH_MSG_LEN));
+}
+
+static void run_verify (bench_t *b)
+{
+  if (hashsig_verify(b->pub, b->sig, b->msg, BENCH_MSG_LEN))
+  {
+    fprintf(stderr, "Verification failed.\n");
+    exit(1);
+  }
+}
+
+/* Call fn in batches taking at least BENCH_MIN_SAMPLE_NS each and record the time per call of each batch. */
+static void bench (bench_t *b, bench_result_t *res, const char *name, const char *unit, const double units, void (*fn) (bench_t *), const size_t samples)
+{
+  double *t = calloc(samples, sizeof(double));
+  double start;
+  size_t batch = 1, i, j;
+
+  /* Warm up and find batch size. */
+  for (;;)
+  {
+    start = now_ns();
+    for (j = 0; j < batch; j++)
+      fn(b);
+    if (now_ns() - start >= BENCH_MIN_SAMPLE_NS)
+      break;
+    batch *= 2;
+  }
+
+  for (i = 0; i < samples; i++)
+  {
+    start = now_ns();
+    for (j = 0; j < batch; j++)
+      fn(b);
+    t[i] = (now_ns() - start) / batch;
+  }
+
+  qsort(t, samples, sizeof(double), compare_double);
+
+  res->name = name;
+  res->unit = unit;
+  res->units = units;
+  res->samples = samples;
+  res->batch = batch;
+  res->p50 = percentile(t, samples, 0.50);
+  res->p99 = percentile(t, samples, 0.99);
+  res->rate = units * 1e9 / res->p50;
+
+  free(t);
+}
+
+/* Thread scaling */
+
+static void *bench_thread (void *arg)
+{
+  bench_thread_t *th = arg;
+  bench_t *b = th->b;
+  void (*fn) (bench_t *) = run_verify;
+  double start, end;
+
+  if (!strcmp(th->op, "sign"))
+  {
+    fn = run_sign;
+    b->ctx = hashsig_create_context_type(b->type, b->priv, hashsig_private_key_length_type(b->type), NULL);
+  }
+  else if (!strcmp(th->op, "keygen"))
+    fn = run_keygen;
+
+  start = now_ns();
+  end = start + th->seconds * 1e9;
+  do
+  {
+    fn(b);
+    th->ops++;
+  } while (now_ns() < end);
+  th->elapsed = (now_ns() - start) / 1e9;
+
+  if (b->ctx != NULL)
+    hashsig_destroy_context(b->ctx);
+
+  return NULL;
+}
+
+static double bench_threads (const bench_t *proto, const char *op, const size_t threads, const double seconds)
+{
+  pthread_t *tid = calloc(threads, sizeof(pthread_t));
+  bench_thread_t *th = calloc(threads, sizeof(bench_thread_t));
+  bench_t *b = calloc(threads, sizeof(bench_t));
+  double rate = 0;
+  size_t i;
+
+  for (i = 0; i < threads; i++)
+  {
+    memcpy(&b[i], proto, sizeof(bench_t));
+    b[i].ctx = NULL;
+    th[i].b = &b[i];
+    th[i].op = op;
+    th[i].seconds = seconds;
+    if (pthread_create(&tid[i], NULL, bench_thread, &th[i]))
+    {
+      fprintf(stderr, "Failed to create thread: %s\n", strerror(errno));
+      exit(1);
+    }
+  }
+
+  for (i = 0; i < threads; i++)
+  {
+    pthread_join(tid[i], NULL);
+    rate += th[i].ops / th[i].elapsed;
+  }
+
+  free(tid);
+  free(th);
+  free(b);
+
+  return rate;
+}
+
+/* Deterministic counts */
+
+/* Fixed workloads, in the order they are run. Not inlined, so callgrind can restrict collection to it. */
+static void __attribute__ ((noinline)) bench_workload (bench_t *b, void (*fn) (bench_t *), const size_t calls)
+{
+  size_t i;
+
+  for (i = 0; i < calls; i++)
+    fn(b);
+}
+
+static size_t bench_workloads (const bench_t *b, bench_count_t *counts)
+{
+  size_t n = 0;
+
+  memset(counts, 0, BENCH_MAX_RESULTS * sizeof(bench_count_t));
+
+#define BENCH_WORKLOAD(wl_name, wl_fn, wl_calls) do { counts[n].name = wl_name; counts[n].fn = wl_fn; counts[n].calls = wl_calls; n++; } while (0)
+  if ((b->type & HASHSIG_FAMILY_MASK) == HASHSIG_FAMILY_KECCAK)
+    BENCH_WORKLOAD("perm", run_perm, 100000);
+  if ((b->type & HASHSIG_FAMILY_MASK) == HASHSIG_FAMILY_TURBOSHAKE)
+    BENCH_WORKLOAD("perm", run_perm12, 100000);
+  BENCH_WORKLOAD("hash", run_hash, 100000);
+  BENCH_WORKLOAD("chains", run_chains, 100);
+  BENCH_WORKLOAD("lmfs_tree", run_lmfs_tree, 1);
+  BENCH_WORKLOAD("keygen", run_keygen, 1);
+  BENCH_WORKLOAD("sign", run_sign, 1);
+  BENCH_WORKLOAD("verify", run_verify, 10);
+#undef BENCH_WORKLOAD
+
+  return n;
+}
+
+static bench_count_t *find_count (bench_count_t *counts, const size_t n, const char *name)
+{
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    if (!strcmp(counts[i].name, name))
+      return &counts[i];
+  return NULL;
+}
+
+#ifdef __linux__
+static int counter_open (const uint64_t config, const int group)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = (group == -1);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+/* Count user space instructions and cycles of each workload. Returns zero on success and one if no counters are available. */
+static int bench_count (bench_t *b, bench_count_t *counts, const size_t n)
+{
+#ifdef __linux__
+  int insn, cycles;
+  uint64_t value;
+  size_t i;
+
+  insn = counter_open(PERF_COUNT_HW_INSTRUCTIONS, -1);
+  if (insn < 0)
+    return 1;
+  cycles = counter_open(PERF_COUNT_HW_CPU_CYCLES, insn);
+
+  for (i = 0; i < n; i++)
+  {
+    ioctl(insn, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(insn, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    bench_workload(b, counts[i].fn, counts[i].calls);
+    ioctl(insn, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    if (read(insn, &value, sizeof(value)) != sizeof(value))
+      return 1;
+    counts[i].instructions = value;
+    if (cycles >= 0 && read(cycles, &value, sizeof(value)) == sizeof(value))
+      counts[i].cycles = value;
+  }
+
+  close(insn);
+  if (cycles >= 0)
+    close(cycles);
+
+  return 0;
+#else
+  return 1;
+#endif
+}
+
+/* Read lines of name and instructions (and calls, for baselines) from a file. Lines starting with # are ignored. Workloads missing from a baseline are not compared. Returns zero on success. */
+static int read_counts (const char *path, bench_count_t *counts, const size_t n, const int baseline)
+{
+  FILE *f = fopen(path, "r");
+  bench_count_t *c;
+  char line[256], name[64];
+  unsigned long long calls, value;
+  size_t i;
+
+  if (f == NULL)
+  {
+    fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    if (line[0] == '#' || line[0] == '\n')
+      continue;
+    if (baseline ? (sscanf(line, "%63s %llu %llu", name, &calls, &value) != 3) : (sscanf(line, "%63s %llu", name, &value) != 2))
+    {
+      fprintf(stderr, "Malformed line in %s: %s", path, line);
+      fclose(f);
+      return 1;
+    }
+    if ((c = find_count(counts, n, name)) == NULL)
+      continue;
+    if (baseline && calls != c->calls)
+    {
+      fprintf(stderr, "Baseline for %s was measured with %llu calls instead of %lu.\n", name, calls, (unsigned long)c->calls);
+      fclose(f);
+      return 1;
+    }
+    if (baseline)
+      c->baseline = value;
+    else
+      c->instructions = value;
+  }
+  fclose(f);
+
+  if (!baseline)
+    for (i = 0; i < n; i++)
+      if (counts[i].instructions == 0)
+      {
+        fprintf(stderr, "No count for %s in %s.\n", counts[i].name, path);
+        return 1;
+      }
+
+  return 0;
+}
+
+static int write_baseline (const char *path, const char *desc, const bench_count_t *counts, const size_t n)
+{
+  FILE *f = fopen(path, "w");
+  size_t i;
+
+  if (f == NULL)
+  {
+    fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+
+  fprintf(f, "# hashsig-bench instruction count baseline for %s\n", desc);
+  fprintf(f, "# Counts depend on compiler and CPU features. Regenerate with: hashsig-bench -c -w <file>\n");
+  fprintf(f, "# name calls instructions\n");
+  for (i = 0; i < n; i++)
+    fprintf(f, "%s %lu %llu\n", counts[i].name, (unsigned long)counts[i].calls, (unsigned long long)counts[i].instructions);
+
+  return fclose(f) ? 1 : 0;
+}
+
+/* Print counts and deviations from the baseline. Returns the number of workloads deviating by more than threshold percent. */
+static int print_counts (FILE *f, const char *desc, const bench_count_t *counts, const size_t n, const double threshold)
+{
+  double dev;
+  size_t i;
+  int failed = 0;
+
+  fprintf(f, "%s\n\n", desc);
+  fprintf(f, "%-10s %8s %16s %16s %16s %10s\n", "workload", "calls", "instructions", "cycles", "baseline", "deviation");
+  for (i = 0; i < n; i++)
+  {
+    fprintf(f, "%-10s %8lu %16llu %16llu", counts[i].name, (unsigned long)counts[i].calls, (unsigned long long)counts[i].instructions, (unsigned long long)counts[i].cycles);
+    if (counts[i].baseline == 0)
+    {
+      fprintf(f, "\n");
+      continue;
+    }
+
+    dev = 100.0 * ((double)counts[i].instructions - (double)counts[i].baseline) / counts[i].baseline;
+    fprintf(f, " %16llu %+9.2f%%", (unsigned long long)counts[i].baseline, dev);
+    if (fabs(dev) > threshold)
+    {
+      fprintf(f, "  %s", (dev > 0) ? "REGRESSION" : "IMPROVEMENT, update baseline");
+      failed++;
+    }
+    fprintf(f, "\n");
+  }
+
+  return failed;
+}
+
+static void print_counts_json (FILE *f, const uint32_t type, const char *desc, const bench_count_t *counts, const size_t n)
+{
+  size_t i;
+
+  fprintf(f, "{\n");
+  fprintf(f, "  \"type\": %lu,\n", (unsigned long)type);
+  fprintf(f, "  \"description\": \"%s\",\n", desc);
+  fprintf(f, "  \"counts\": [\n");
+  for (i = 0; i < n; i++)
+    fprintf(f, "    { \"name\": \"%s\", \"calls\": %lu, \"instructions\": %llu, \"cycles\": %llu, \"baseline\": %llu }%s\n",
+            counts[i].name, (unsigned long)counts[i].calls, (unsigned long long)counts[i].instructions, (unsigned long long)counts[i].cycles, (unsigned long long)counts[i].baseline, (i + 1 < n) ? "," : "");
+  fprintf(f, "  ]\n");
+  fprintf(f, "}\n");
+}
+
+/* Output */
+
+static void print_table (FILE *f, const char *desc, const bench_result_t *res, const size_t n, const char *op, const bench_run_t *runs, const size_t n_runs, const long rss)
+{
+  size_t i;
+
+  fprintf(f, "%s\n\n", desc);
+  fprintf(f, "%-10s %8s %14s %14s %16s\n", "benchmark", "samples", "p50", "p99", "rate");
+  for (i = 0; i < n; i++)
+  {
+    if (res[i].p50 < 1e6)
+      fprintf(f, "%-10s %8lu %11.1f ns %11.1f ns %12.0f/s %s\n", res[i].name, (unsigned long)res[i].samples, res[i].p50, res[i].p99, res[i].rate, res[i].unit);
+    else
+      fprintf(f, "%-10s %8lu %11.3f ms %11.3f ms %12.2f/s %s\n", res[i].name, (unsigned long)res[i].samples, res[i].p50 / 1e6, res[i].p99 / 1e6, res[i].rate, res[i].unit);
+  }
+
+  fprintf(f, "\n%-10s %16s %10s\n", "threads", op, "scaling");
+  for (i = 0; i < n_runs; i++)
+    fprintf(f, "%-10lu %14.2f/s %9.2fx\n", (unsigned long)runs[i].threads, runs[i].rate, runs[i].rate / runs[0].rate);
+
+  fprintf(f, "\npeak RSS: %ld KiB\n", rss);
+}
+
+static void print_json (FILE *f, const uint32_t type, const char *desc, const size_t lanes, const bench_result_t *res, const size_t n, const char *op, const double seconds, const bench_run_t *runs, const size_t n_runs, const long rss)
+{
+  size_t i;
+
+  fprintf(f, "{\n");
+  fprintf(f, "  \"type\": %lu,\n", (unsigned long)type);
+  fprintf(f, "  \"description\": \"%s\",\n", desc);
+  fprintf(f, "  \"lanes\": %lu,\n", (unsigned long)lanes);
+  fprintf(f, "  \"benchmarks\": [\n");
+  for (i = 0; i < n; i++)
+    fprintf(f, "    { \"name\": \"%s\", \"unit\": \"%s\", \"units_per_call\": %.0f, \"samples\": %lu, \"batch\": %lu, \"p50_ns\": %.1f, \"p99_ns\": %.1f, \"rate\": %.3f }%s\n",
+            res[i].name, res[i].unit, res[i].units, (unsigned long)res[i].samples, (unsigned long)res[i].batch, res[i].p50, res[i].p99, res[i].rate, (i + 1 < n) ? "," : "");
+  fprintf(f, "  ],\n");
+  fprintf(f, "  \"throughput\": {\n");
+  fprintf(f, "    \"operation\": \"%s\",\n", op);
+  fprintf(f, "    \"seconds\": %.3f,\n", seconds);
+  fprintf(f, "    \"runs\": [\n");
+  for (i = 0; i < n_runs; i++)
+    fprintf(f, "      { \"threads\": %lu, \"rate\": %.3f }%s\n", (unsigned long)runs[i].threads, runs[i].rate, (i + 1 < n_runs) ? "," : "");
+  fprintf(f, "    ]\n");
+  fprintf(f, "  },\n");
+  fprintf(f, "  \"peak_rss_kib\": %ld\n", rss);
+  fprintf(f, "}\n");
+}
+
+/* Count mode, returns the exit status. */
+static int bench_counts_main (bench_t *b, const char *desc, const char *workload, const int list, const char *counts_file, const char *baseline, const char *write, const double threshold, const char *json)
+{
+  bench_count_t counts[BENCH_MAX_RESULTS];
+  bench_count_t *c;
+  const size_t n = bench_workloads(b, counts);
+  FILE *f;
+  size_t i;
+  int failed;
+
+  if (list)
+  {
+    for (i = 0; i < n; i++)
+      printf("%s\n", counts[i].name);
+    return 0;
+  }
+
+  /* Only run one workload, for external measurements. The signature is only needed for verification, and is costly. */
+  if (workload != NULL)
+  {
+    if ((c = find_count(counts, n, workload)) == NULL)
+    {
+      fprintf(stderr, "Unknown workload %s.\n", workload);
+      return 1;
+    }
+    if (c->fn == run_verify)
+      b->sig = hashsig_sign(b->ctx, b->msg, BENCH_MSG_LEN);
+    bench_workload(b, c->fn, c->calls);
+    return 0;
+  }
+
+  b->sig = hashsig_sign(b->ctx, b->msg, BENCH_MSG_LEN);
+
+  if (counts_file != NULL)
+  {
+    if (read_counts(counts_file, counts, n, 0))
+      return 1;
+  }
+  else if (bench_count(b, counts, n))
+  {
+    fprintf(stderr, "Hardware performance counters are unavailable.\n");
+    return BENCH_SKIP;
+  }
+
+  if (baseline != NULL && read_counts(baseline, counts, n, 1))
+    return 1;
+
+  failed = print_counts((json != NULL && !strcmp(json, "-")) ? stderr : stdout, desc, counts, n, threshold);
+
+  if (json != NULL)
+  {
+    f = strcmp(json, "-") ? fopen(json, "w") : stdout;
+    if (f == NULL)
+    {
+      fprintf(stderr, "Failed to open %s: %s\n", json, strerror(errno));
+      return 1;
+    }
+    print_counts_json(f, b->type, desc, counts, n);
+    if (f != stdout)
+      fclose(f);
+  }
+
+  if (write != NULL && write_baseline(write, desc, counts, n))
+    return 1;
+
+  if (failed)
+  {
+    fprintf(stderr, "%d workload(s) deviate from the baseline by more than %.2f%%.\n", failed, threshold);
+    return 1;
+  }
+
+  return 0;
+}
+
+static void usage (const char *name)
+{
+  fprintf(stderr, "Usage: %s [-t type] [-s samples] [-o verify|sign|keygen] [-n threads] [-d seconds] [-j file]\n", name);
+  fprintf(stderr, "       %s -c [-t type] [-b baseline] [-x percent] [-w baseline] [-i counts] [-j file]\n", name);
+  fprintf(stderr, "       %s -c [-t type] -l | -W workload\n", name);
+  fprintf(stderr, "  -t type     Signature type (default 0x%02x)\n", HASHSIG_TYPE_KECCAK_T32_B8_M32_N32_W4);
+  fprintf(stderr, "  -s samples  Samples for signing; other benchmarks scale from this (default 3)\n");
+  fprintf(stderr, "  -o op       Operation for the thread scaling runs (default verify)\n");
+  fprintf(stderr, "  -n threads  Maximum number of threads (default: online CPUs)\n");
+  fprintf(stderr, "  -d seconds  Duration of each thread scaling run (default 1)\n");
+  fprintf(stderr, "  -j file     Also write results as JSON to file, - for standard output\n");
+  fprintf(stderr, "  -c          Count instructions and cycles of fixed workloads instead\n");
+  fprintf(stderr, "  -b file     Compare instruction counts against baseline file\n");
+  fprintf(stderr, "  -x percent  Maximum deviation from the baseline (default 3)\n");
+  fprintf(stderr, "  -w file     Write instruction counts to baseline file\n");
+  fprintf(stderr, "  -i file     Read instruction counts measured externally from file\n");
+  fprintf(stderr, "  -l          List workloads\n");
+  fprintf(stderr, "  -W name     Only run workload, e.g. under callgrind\n");
+}
+
+int main (int argc, char *argv[])
+{
+  bench_t b;
+  bench_result_t res[BENCH_MAX_RESULTS];
+  bench_run_t runs[BENCH_MAX_RUNS];
+  struct rusage usage_self;
+  char desc[128];
+  const char *op = "verify";
+  const char *json = NULL;
+  const char *baseline = NULL, *write = NULL, *counts_file = NULL, *workload = NULL;
+  FILE *table = stdout;
+  FILE *f;
+  double seconds = 1, threshold = 3;
+  long max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t samples = 3;
+  size_t n = 0, n_runs = 0, i, t;
+  int c, count = 0, list = 0, ret;
+
+  memset(&b, 0, sizeof(b));
+  b.type = HASHSIG_TYPE_KECCAK_T32_B8_M32_N32_W4;
+
+  while ((c = getopt(argc, argv, "t:s:o:n:d:j:cb:x:w:i:lW:h")) != -1)
+  {
+    switch (c)
+    {
+      case 't':
+        b.type = strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        samples = strtoul(optarg, NULL, 0);
+        break;
+      case 'o':
+        op = optarg;
+        break;
+      case 'n':
+        max_threads = strtol(optarg, NULL, 0);
+        break;
+      case 'd':
+        seconds = strtod(optarg, NULL);
+        break;
+      case 'j':
+        json = optarg;
+        break;
+      case 'c':
+        count = 1;
+        break;
+      case 'b':
+        baseline = optarg;
+        break;
+      case 'x':
+        threshold = strtod(optarg, NULL);
+        break;
+      case 'w':
+        write = optarg;
+        break;
+      case 'i':
+        counts_file = optarg;
+        break;
+      case 'l':
+        list = 1;
+        break;
+      case 'W':
+        workload = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (samples < 1 || max_threads < 1 || seconds <= 0 || threshold < 0 || (!count && (list || workload || baseline || write || counts_file)) || (strcmp(op, "verify") && strcmp(op, "sign") && strcmp(op, "keygen")))
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  /* Deterministic key and message, so runs are comparable. */
+  for (i = 0; i < sizeof(b.priv); i++)
+    b.priv[i] = i;
+  for (i = 0; i < BENCH_MSG_LEN; i++)
+    b.msg[i] = i;
+
+  b.ctx = hashsig_create_context_type(b.type, b.priv, hashsig_private_key_length_type(b.type), NULL);
+  if (b.ctx == NULL)
+  {
+    fprintf(stderr, "Unsupported type 0x%02lx.\n", (unsigned long)b.type);
+    return 1;
+  }
+  b.pub = hashsig_get_public_key(b.ctx);
+  hashsig_public_key_type(b.pub, desc, sizeof(desc));
+  hashsig_KeccakF1600_StateInitialize(b.state);
+
+  if (count)
+  {
+    ret = bench_counts_main(&b, desc, workload, list, counts_file, baseline, write, threshold, json);
+    hashsig_free(b.pub);
+    hashsig_free(b.sig);
+    hashsig_destroy_context(b.ctx);
+    return ret;
+  }
+
+  b.sig = hashsig_sign(b.ctx, b.msg, BENCH_MSG_LEN);
+
+  if (json != NULL && !strcmp(json, "-"))
+    table = stderr;
+
+  /* Primitives */
+  if ((b.type & HASHSIG_FAMILY_MASK) == HASHSIG_FAMILY_KECCAK)
+    bench(&b, &res[n++], "perm", "perm", 1, run_perm, 100 * samples);
+  if ((b.type & HASHSIG_FAMILY_MASK) == HASHSIG_FAMILY_TURBOSHAKE)
+    bench(&b, &res[n++], "perm", "perm", 1, run_perm12, 100 * samples);
+  bench(&b, &res[n++], "hash", "hash", 1, run_hash, 100 * samples);
+  bench(&b, &res[n++], "chains", "step", LDWM_P * LDWM_2_POW_W_MINUS_1, run_chains, 100 * samples);
+  bench(&b, &res[n++], "lmfs_tree", "tree", 1, run_lmfs_tree, 3 * samples);
+
+  /* End-to-end operations */
+  bench(&b, &res[n++], "keygen", "key", 1, run_keygen, 3 * samples);
+  bench(&b, &res[n++], "sign", "sig", 1, run_sign, samples);
+  bench(&b, &res[n++], "verify", "sig", 1, run_verify, 30 * samples);
+
+  /* Thread scaling: 1, 2, 4, ... threads, and the maximum. */
+  for (t = 1; n_runs < BENCH_MAX_RUNS; t *= 2)
+  {
+    if (t > (size_t)max_threads)
+      t = max_threads;
+    runs[n_runs].threads = t;
+    runs[n_runs].rate = bench_threads(&b, op, t, seconds);
+    n_runs++;
+    if (t == (size_t)max_threads)
+      break;
+  }
+
+  getrusage(RUSAGE_SELF, &usage_self);
+
+  print_table(table, desc, res, n, op, runs, n_runs, usage_self.ru_maxrss);
+
+  if (json != NULL)
+  {
+    f = strcmp(json, "-") ? fopen(json, "w") : stdout;
+    if (f == NULL)
+    {
+      fprintf(stderr, "Failed to open %s: %s\n", json, strerror(errno));
+      return 1;
+    }
+    print_json(f, b.type, desc, b.ctx->backend->lanes, res, n, op, seconds, runs, n_runs, usage_self.ru_maxrss);
+    if (f != stdout)
+      fclose(f);
+  }
+
+  hashsig_free(b.pub);
+  hashsig_free(b.sig);
+  hashsig_destroy_context(b.ctx);
+
+  return 0;
+}
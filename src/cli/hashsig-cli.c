@@ -0,0 +1,625 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Command line tool
+ *
+ * Generates keys, signs files and verifies them with detached signatures.
+ * Inputs are memory mapped. Signing spreads the trees of each signature over
+ * a thread pool, and verify-many checks a whole list of files as one batch.
+ * -j sets the number of threads, including the calling one, by default one
+ * per online CPU.
+ *
+ * Files:
+ *   Private key  Type byte followed by the private key, created with mode 0600
+ *   Public key   Output of hashsig_pub2buf
+ *   Signature    Output of hashsig_sig2buf, by default FILE.sig for FILE */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "hashsig.h"
+
+#define CLI_OK 0
+#define CLI_BAD 1
+#define CLI_ERROR 2
+
+/* Files verified at once by verify-many, bounding the number of mappings. */
+#define CLI_BATCH 256
+
+#define CLI_SIG_SUFFIX ".sig"
+
+typedef struct
+{
+  uint8_t *data;
+  size_t len;
+  int mapped;
+} cli_map_t;
+
+static const hashsig_executor_t *executor;
+
+static int cli_inline_submit (void *opaque, void (*task) (void *arg), void *arg)
+{
+  (void)opaque;
+  (void)task;
+  (void)arg;
+  return 1;
+}
+
+static void *cli_inline_wait_group_create (void *opaque, const size_t tasks)
+{
+  (void)opaque;
+  (void)tasks;
+  return NULL;
+}
+
+/* Executor for -j 1, running all tasks on the calling thread. */
+static const hashsig_executor_t cli_inline_executor = { cli_inline_submit, cli_inline_wait_group_create, NULL, NULL, 1, NULL };
+
+/* Map a file read-only. Empty files and those that cannot be mapped, e.g. pipes, are read instead. */
+static int cli_map (cli_map_t *map, const char *path)
+{
+  struct stat st;
+  size_t size = 0;
+  ssize_t got;
+  int fd;
+
+  memset(map, 0, sizeof(cli_map_t));
+  if ((fd = strcmp(path, "-") ? open(path, O_RDONLY) : dup(STDIN_FILENO)) < 0)
+  {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+  {
+    map->data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map->data != MAP_FAILED)
+    {
+      map->len = st.st_size;
+      map->mapped = 1;
+      madvise(map->data, map->len, MADV_SEQUENTIAL);
+      close(fd);
+      return 0;
+    }
+    map->data = NULL;
+  }
+
+  for (;;)
+  {
+    if (size - map->len < 65536)
+    {
+      uint8_t *data = realloc(map->data, size + 65536);
+
+      if (data == NULL)
+      {
+        fprintf(stderr, "%s: Out of memory.\n", path);
+        goto fail;
+      }
+      map->data = data;
+      size += 65536;
+    }
+
+    if ((got = read(fd, map->data + map->len, size - map->len)) == 0)
+      break;
+    if (got < 0 && errno != EINTR)
+    {
+      fprintf(stderr, "%s: %s\n", path, strerror(errno));
+      goto fail;
+    }
+    if (got > 0)
+      map->len += got;
+  }
+
+  close(fd);
+  return 0;
+
+fail:
+  free(map->data);
+  map->data = NULL;
+  close(fd);
+  return -1;
+}
+
+static void cli_unmap (cli_map_t *map)
+{
+  if (map->mapped)
+    munmap(map->data, map->len);
+  else
+    free(map->data);
+  map->data = NULL;
+}
+
+/* Write a whole file through a temporary one renamed into place, so no truncated key or signature is left behind. */
+static int cli_write (const char *path, const uint8_t *data, const size_t len, const mode_t mode)
+{
+  char *tmp;
+  size_t done = 0;
+  ssize_t got;
+  mode_t mask;
+  int fd;
+
+  if (!strcmp(path, "-"))
+    return fwrite(data, 1, len, stdout) == len && fflush(stdout) == 0 ? 0 : -1;
+
+  if ((tmp = malloc(strlen(path) + 8)) == NULL)
+    return -1;
+  sprintf(tmp, "%s.XXXXXX", path);
+
+  /* mkstemp creates a new file only accessible by the owner, never an existing one or the target of a symlink. Apply the mode, less the umask, before writing anything. */
+  mask = umask(0);
+  umask(mask);
+  if ((fd = mkstemp(tmp)) < 0)
+  {
+    fprintf(stderr, "%s: %s\n", tmp, strerror(errno));
+    free(tmp);
+    return -1;
+  }
+  if (fchmod(fd, mode & ~mask))
+  {
+    fprintf(stderr, "%s: %s\n", tmp, strerror(errno));
+    close(fd);
+    unlink(tmp);
+    free(tmp);
+    return -1;
+  }
+
+  while (done < len)
+  {
+    if ((got = write(fd, data + done, len - done)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    done += got;
+  }
+
+  if (done < len || fsync(fd) || close(fd) || rename(tmp, path))
+  {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    unlink(tmp);
+    free(tmp);
+    return -1;
+  }
+
+  free(tmp);
+  return 0;
+}
+
+/* Create a context from a private key file, reading the key into priv of 64 bytes, which is locked into memory where possible. Callers wipe it and unlock it with cli_wipe. */
+static hashsig_t *cli_context (const char *path, uint8_t *priv, size_t *priv_len)
+{
+  cli_map_t map;
+  hashsig_t *ctx;
+  uint32_t type;
+
+  /* Failing to lock, e.g. due to RLIMIT_MEMLOCK, is not fatal. */
+  mlock(priv, 64);
+
+  if (cli_map(&map, path))
+    return NULL;
+
+  type = map.len > 0 ? map.data[0] : 0;
+  *priv_len = hashsig_private_key_length_type(type);
+  if (map.len != *priv_len + 1)
+  {
+    fprintf(stderr, "%s: Not a private key.\n", path);
+    cli_unmap(&map);
+    return NULL;
+  }
+  memcpy(priv, map.data + 1, *priv_len);
+  cli_unmap(&map);
+
+  if ((ctx = hashsig_create_context_parallel(type, priv, *priv_len, NULL, executor)) == NULL)
+    fprintf(stderr, "%s: Unsupported type 0x%02lx.\n", path, (unsigned long)type);
+  return ctx;
+}
+
+static void cli_wipe (uint8_t *priv)
+{
+  memset(priv, 0, 64);
+  __sync_synchronize();
+  munlock(priv, 64);
+}
+
+static int cli_write_public_key (hashsig_t *ctx, const char *path)
+{
+  hashsig_pub_t *pub = hashsig_get_public_key(ctx);
+  size_t len = hashsig_public_key_length(ctx);
+  uint8_t *buf = calloc(1, len);
+  int ret;
+
+  hashsig_pub2buf(pub, buf, len);
+  ret = cli_write(path, buf, len, 0644);
+  hashsig_free(pub);
+  free(buf);
+
+  return ret;
+}
+
+static int cli_keygen (uint32_t type, const char *priv_path, const char *pub_path)
+{
+  uint8_t key[1 + 64];
+  size_t priv_len = hashsig_private_key_length_type(type);
+  hashsig_t *ctx = NULL;
+  int fd, ret = CLI_ERROR;
+
+  key[0] = type;
+  if ((fd = open("/dev/urandom", O_RDONLY)) < 0 || read(fd, key + 1, priv_len) != (ssize_t)priv_len)
+  {
+    fprintf(stderr, "/dev/urandom: %s\n", strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return CLI_ERROR;
+  }
+  close(fd);
+
+  if ((ctx = hashsig_create_context_parallel(type, key + 1, priv_len, NULL, executor)) == NULL)
+    fprintf(stderr, "Unsupported type 0x%02lx.\n", (unsigned long)type);
+  else if (!cli_write(priv_path, key, 1 + priv_len, 0600) && !cli_write_public_key(ctx, pub_path))
+    ret = CLI_OK;
+
+  if (ctx != NULL)
+    hashsig_destroy_context(ctx);
+  memset(key, 0, sizeof(key));
+  __sync_synchronize();
+
+  return ret;
+}
+
+static int cli_pubkey (const char *priv_path, const char *pub_path)
+{
+  uint8_t priv[64];
+  size_t priv_len;
+  hashsig_t *ctx = cli_context(priv_path, priv, &priv_len);
+  int ret = CLI_ERROR;
+
+  if (ctx != NULL)
+  {
+    if (!cli_write_public_key(ctx, pub_path))
+      ret = CLI_OK;
+    hashsig_destroy_context(ctx);
+  }
+  cli_wipe(priv);
+
+  return ret;
+}
+
+static char *cli_sig_path (const char *path)
+{
+  char *sig_path = malloc(strlen(path) + sizeof(CLI_SIG_SUFFIX));
+
+  if (sig_path != NULL)
+    sprintf(sig_path, "%s" CLI_SIG_SUFFIX, path);
+  return sig_path;
+}
+
+/* Sign each file into FILE.sig, or into out if there is only one. */
+static int cli_sign (const char *priv_path, const char *out, char **files, const int count)
+{
+  uint8_t priv[64];
+  size_t priv_len, sig_len;
+  hashsig_t *ctx = cli_context(priv_path, priv, &priv_len);
+  uint8_t *sig;
+  cli_map_t map;
+  char *sig_path;
+  int i, ret = CLI_OK;
+
+  if (ctx == NULL)
+  {
+    cli_wipe(priv);
+    return CLI_ERROR;
+  }
+
+  sig_len = hashsig_signature_length(ctx);
+  sig = calloc(1, sig_len);
+  for (i = 0; i < count && ret == CLI_OK; i++)
+  {
+    if (cli_map(&map, files[i]))
+    {
+      ret = CLI_ERROR;
+      break;
+    }
+
+    hashsig_sign_parallel(ctx, map.data, map.len, sig, sig_len, executor);
+    cli_unmap(&map);
+
+    sig_path = out != NULL ? NULL : cli_sig_path(files[i]);
+    if (cli_write(out != NULL ? out : sig_path, sig, sig_len, 0644))
+      ret = CLI_ERROR;
+    free(sig_path);
+  }
+
+  free(sig);
+  hashsig_destroy_context(ctx);
+  cli_wipe(priv);
+
+  return ret;
+}
+
+static int cli_load_public_key (const char *path, cli_map_t *map, hashsig_pub_view_t *view)
+{
+  if (cli_map(map, path))
+    return -1;
+
+  if (hashsig_pub_view(view, map->data, map->len))
+  {
+    fprintf(stderr, "%s: Not a supported public key.\n", path);
+    cli_unmap(map);
+    return -1;
+  }
+
+  return 0;
+}
+
+/* Verify files against their signatures in batches, printing one line per file. Returns CLI_BAD if any of them fails. */
+static int cli_verify_files (const hashsig_pub_view_t *pub, char **files, char **sig_files, const size_t count)
+{
+  hashsig_pub_view_t pubs[CLI_BATCH];
+  hashsig_sig_view_t sigs[CLI_BATCH];
+  const uint8_t *messages[CLI_BATCH];
+  size_t lens[CLI_BATCH];
+  int results[CLI_BATCH];
+  cli_map_t maps[CLI_BATCH], sig_maps[CLI_BATCH];
+  int ok[CLI_BATCH];
+  size_t start, n, i;
+  char *sig_path;
+  int ret = CLI_OK;
+
+  for (start = 0; start < count; start += n)
+  {
+    n = (count - start < CLI_BATCH) ? count - start : CLI_BATCH;
+
+    for (i = 0; i < n; i++)
+    {
+      sig_path = sig_files != NULL ? NULL : cli_sig_path(files[start + i]);
+      ok[i] = 0;
+      if (cli_map(&maps[i], files[start + i]) == 0)
+      {
+        if (cli_map(&sig_maps[i], sig_files != NULL ? sig_files[start + i] : sig_path) == 0)
+        {
+          ok[i] = 1;
+          if (hashsig_sig_view(&sigs[i], sig_maps[i].data, sig_maps[i].len) || sigs[i].type != pub->type)
+          {
+            /* Verified as bad below without touching the signature. */
+            memset(&sigs[i], 0, sizeof(hashsig_sig_view_t));
+            ok[i] = -1;
+          }
+        }
+        else
+          cli_unmap(&maps[i]);
+      }
+      free(sig_path);
+
+      pubs[i] = *pub;
+      messages[i] = maps[i].data;
+      lens[i] = maps[i].len;
+    }
+
+    /* Compact the entries that can be verified to the front. */
+    {
+      size_t j = 0, idx[CLI_BATCH];
+
+      for (i = 0; i < n; i++)
+        if (ok[i] == 1)
+        {
+          idx[j] = i;
+          sigs[j] = sigs[i];
+          messages[j] = messages[i];
+          lens[j] = lens[i];
+          j++;
+        }
+
+      hashsig_verify_batch(pubs, sigs, messages, lens, j, results, executor);
+
+      for (i = j; i-- > 0; )
+        results[idx[i]] = results[i];
+    }
+
+    for (i = 0; i < n; i++)
+    {
+      if (ok[i] == 0)
+      {
+        printf("%s: ERROR\n", files[start + i]);
+        ret = CLI_ERROR;
+        continue;
+      }
+
+      if (ok[i] < 0 || results[i])
+      {
+        printf("%s: FAILED\n", files[start + i]);
+        if (ret == CLI_OK)
+          ret = CLI_BAD;
+      }
+      else
+        printf("%s: OK\n", files[start + i]);
+
+      cli_unmap(&maps[i]);
+      cli_unmap(&sig_maps[i]);
+    }
+  }
+
+  return ret;
+}
+
+static int cli_verify (const char *pub_path, char *file, char *sig_file)
+{
+  hashsig_pub_view_t pub;
+  cli_map_t map;
+  int ret;
+
+  if (cli_load_public_key(pub_path, &map, &pub))
+    return CLI_ERROR;
+  ret = cli_verify_files(&pub, &file, sig_file != NULL ? &sig_file : NULL, 1);
+  cli_unmap(&map);
+
+  return ret;
+}
+
+/* Verify the files given, or listed one per line in standard input if there are none. */
+static int cli_verify_many (const char *pub_path, char **files, size_t count)
+{
+  hashsig_pub_view_t pub;
+  cli_map_t map, list;
+  char **listed;
+  char *text;
+  size_t i, start;
+  int ret;
+
+  if (cli_load_public_key(pub_path, &map, &pub))
+    return CLI_ERROR;
+
+  if (count == 0)
+  {
+    if (cli_map(&list, "-"))
+    {
+      cli_unmap(&map);
+      return CLI_ERROR;
+    }
+
+    /* Copy the list, so each line can be terminated. */
+    listed = calloc(list.len + 1, sizeof(char *));
+    text = calloc(1, list.len + 1);
+    memcpy(text, list.data, list.len);
+    cli_unmap(&list);
+
+    for (i = 0, start = 0; i <= list.len; i++)
+      if (i == list.len || text[i] == '\n')
+      {
+        text[i] = 0;
+        if (i > start)
+          listed[count++] = text + start;
+        start = i + 1;
+      }
+
+    ret = cli_verify_files(&pub, listed, NULL, count);
+    free(text);
+    free(listed);
+  }
+  else
+    ret = cli_verify_files(&pub, files, NULL, count);
+
+  cli_unmap(&map);
+
+  return ret;
+}
+
+static void usage (const char *name)
+{
+  fprintf(stderr, "Usage: %s [-j threads] [-t type] keygen PRIVATE PUBLIC\n", name);
+  fprintf(stderr, "       %s [-j threads] pubkey PRIVATE PUBLIC\n", name);
+  fprintf(stderr, "       %s [-j threads] [-o SIGNATURE] sign PRIVATE FILE...\n", name);
+  fprintf(stderr, "       %s verify PUBLIC FILE [SIGNATURE]\n", name);
+  fprintf(stderr, "       %s [-j threads] verify-many PUBLIC [FILE...]\n", name);
+  fprintf(stderr, "  -j threads    Number of threads (default: online CPUs)\n");
+  fprintf(stderr, "  -t type       Signature type for new keys (default 0x%02x)\n", HASHSIG_TYPE_KECCAK_T32_B8_M32_N32_W4);
+  fprintf(stderr, "  -o SIGNATURE  Signature file for a single FILE, - for standard output (default FILE" CLI_SIG_SUFFIX ")\n");
+  fprintf(stderr, "Files are signed into FILE" CLI_SIG_SUFFIX ". verify-many reads the list of files from standard input if none are given.\n");
+  fprintf(stderr, "Exit status is 0 if all signatures are good, 1 if any is bad and 2 on errors.\n");
+}
+
+int main (int argc, char *argv[])
+{
+  hashsig_executor_t pool_executor;
+  hashsig_pool_t *pool = NULL;
+  uint32_t type = HASHSIG_TYPE_KECCAK_T32_B8_M32_N32_W4;
+  const char *out = NULL;
+  const char *cmd;
+  long threads = 0;
+  int c, args, ret;
+
+  while ((c = getopt(argc, argv, "+j:t:o:h")) != -1)
+  {
+    switch (c)
+    {
+      case 'j':
+        threads = strtol(optarg, NULL, 0);
+        break;
+      case 't':
+        type = strtoul(optarg, NULL, 0);
+        break;
+      case 'o':
+        out = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return CLI_ERROR;
+    }
+  }
+
+  if (optind >= argc || threads < 0)
+  {
+    usage(argv[0]);
+    return CLI_ERROR;
+  }
+  cmd = argv[optind++];
+  args = argc - optind;
+
+  /* The default pool already has one thread per CPU. The thread waiting for the tasks helps running them, so the pool gets one thread less. */
+  if (threads == 1)
+    executor = &cli_inline_executor;
+  else if (threads > 1)
+  {
+    if ((pool = hashsig_pool_create(threads - 1)) != NULL)
+    {
+      hashsig_pool_executor(pool, &pool_executor);
+      executor = &pool_executor;
+    }
+  }
+
+  if (!strcmp(cmd, "keygen") && args == 2)
+    ret = cli_keygen(type, argv[optind], argv[optind + 1]);
+  else if (!strcmp(cmd, "pubkey") && args == 2)
+    ret = cli_pubkey(argv[optind], argv[optind + 1]);
+  else if (!strcmp(cmd, "sign") && args >= 2 && (out == NULL || args == 2))
+    ret = cli_sign(argv[optind], out, argv + optind + 1, args - 1);
+  else if (!strcmp(cmd, "verify") && (args == 2 || args == 3))
+    ret = cli_verify(argv[optind], argv[optind + 1], args == 3 ? argv[optind + 2] : NULL);
+  else if (!strcmp(cmd, "verify-many") && args >= 1)
+    ret = cli_verify_many(argv[optind], argv + optind + 1, args - 1);
+  else
+  {
+    usage(argv[0]);
+    ret = CLI_ERROR;
+  }
+
+  if (pool != NULL)
+    hashsig_pool_destroy(pool);
+
+  return ret;
+}
@@ -0,0 +1,296 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Load generator for hashsigd
+ *
+ * Opens -c connections and sends -n sign requests over them in total, as fast
+ * as the daemon answers. Reports the throughput, how many requests were turned
+ * away or expired, and the median (p50) and 99th percentile (p99) latency of
+ * the signed ones. With -v, every signature is verified against the public key
+ * the daemon reports. */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hashsig.h"
+#include "hashsigd.h"
+
+typedef struct
+{
+  const char *path;
+  size_t index;
+  hashsigd_request_t request;
+  size_t requests;
+  int verify;
+  const uint8_t *pub;
+  size_t pub_len;
+  double *latencies;
+  size_t counts[HASHSIGD_INVALID + 1];
+  size_t bad;
+  int failed;
+} load_thread_t;
+
+static double load_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Send a request and read its response into data, which is reallocated as needed. Returns the status or -1 on errors. */
+static int load_request (int fd, const hashsigd_request_t *request, const uint8_t *message, uint8_t **data, size_t *len)
+{
+  uint8_t header[HASHSIGD_REQUEST_LEN > HASHSIGD_RESPONSE_LEN ? HASHSIGD_REQUEST_LEN : HASHSIGD_RESPONSE_LEN];
+
+  /* The daemon may answer with HASHSIGD_BUSY and close the connection without reading the request, so read the response even if sending fails. */
+  hashsigd_encode_request(header, request);
+  if (!hashsigd_write(fd, header, HASHSIGD_REQUEST_LEN))
+    hashsigd_write(fd, message, request->len);
+  if (hashsigd_read(fd, header, HASHSIGD_RESPONSE_LEN))
+    return -1;
+
+  *len = header[4] | header[5] << 8 | header[6] << 16 | (size_t)header[7] << 24;
+  if ((*data = realloc(*data, *len + 1)) == NULL || hashsigd_read(fd, *data, *len))
+    return -1;
+
+  return header[0] <= HASHSIGD_INVALID ? header[0] : -1;
+}
+
+static void *load_thread (void *arg)
+{
+  load_thread_t *t = arg;
+  hashsig_pub_view_t pub;
+  hashsig_sig_view_t sig;
+  uint8_t *message = malloc(t->request.len + 1);
+  uint8_t *data = NULL;
+  size_t i, len;
+  double start;
+  int fd, status;
+
+  if ((fd = hashsigd_connect(t->path)) < 0)
+  {
+    t->failed = 1;
+    free(message);
+    return NULL;
+  }
+  if (t->verify)
+    hashsig_pub_view(&pub, t->pub, t->pub_len);
+
+  for (i = 0; i < t->requests; i++)
+  {
+    /* Distinct messages, so their hashes differ as in real use. */
+    memset(message, 0, t->request.len);
+    snprintf((char *)message, t->request.len, "%zu %zu", t->index, i);
+
+    start = load_now();
+    if ((status = load_request(fd, &t->request, message, &data, &len)) < 0)
+    {
+      t->failed = 1;
+      break;
+    }
+    t->counts[status]++;
+
+    /* The daemon may have closed the connection after turning the request away. */
+    if (status == HASHSIGD_BUSY)
+    {
+      close(fd);
+      if ((fd = hashsigd_connect(t->path)) < 0)
+      {
+        t->failed = 1;
+        break;
+      }
+    }
+
+    if (status == HASHSIGD_OK)
+    {
+      t->latencies[t->counts[HASHSIGD_OK] - 1] = load_now() - start;
+      if (t->verify && (hashsig_sig_view(&sig, data, len) || hashsig_verify_view(&pub, &sig, message, t->request.len)))
+        t->bad++;
+    }
+  }
+
+  if (fd >= 0)
+    close(fd);
+  free(data);
+  free(message);
+
+  return NULL;
+}
+
+static int load_compare (const void *a, const void *b)
+{
+  const double x = *(const double *)a, y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+static void usage (const char *name)
+{
+  fprintf(stderr, "Usage: %s -s socket [-c connections] [-n requests] [-l length] [-k key] [-p priority] [-d milliseconds] [-v]\n", name);
+  fprintf(stderr, "  -s socket        Path of the socket hashsigd listens on\n");
+  fprintf(stderr, "  -c connections   Number of concurrent connections (default 8)\n");
+  fprintf(stderr, "  -n requests      Total number of sign requests (default 64)\n");
+  fprintf(stderr, "  -l length        Message length in bytes (default 1024)\n");
+  fprintf(stderr, "  -k key           Key number (default 0)\n");
+  fprintf(stderr, "  -p priority      Priority of the requests (default 0)\n");
+  fprintf(stderr, "  -d milliseconds  Deadline of the requests (default: none)\n");
+  fprintf(stderr, "  -v               Verify the signatures\n");
+}
+
+int main (int argc, char *argv[])
+{
+  hashsigd_request_t request;
+  load_thread_t *threads;
+  pthread_t *ids;
+  const char *path = NULL;
+  uint8_t *pub = NULL;
+  size_t connections = 8, requests = 64, pub_len = 0, ok = 0, counts[HASHSIGD_INVALID + 1] = { 0 }, bad = 0, i, j;
+  double *latencies, start, seconds;
+  int c, fd, verify = 0, failed = 0;
+
+  memset(&request, 0, sizeof(request));
+  request.op = HASHSIGD_OP_SIGN;
+  request.len = 1024;
+
+  while ((c = getopt(argc, argv, "s:c:n:l:k:p:d:vh")) != -1)
+  {
+    switch (c)
+    {
+      case 's':
+        path = optarg;
+        break;
+      case 'c':
+        connections = strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        requests = strtoul(optarg, NULL, 0);
+        break;
+      case 'l':
+        request.len = strtoull(optarg, NULL, 0);
+        break;
+      case 'k':
+        request.key = strtoul(optarg, NULL, 0);
+        break;
+      case 'p':
+        request.priority = strtoul(optarg, NULL, 0);
+        break;
+      case 'd':
+        request.deadline = strtoul(optarg, NULL, 0);
+        break;
+      case 'v':
+        verify = 1;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (path == NULL || connections < 1 || requests < connections)
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (verify)
+  {
+    hashsigd_request_t pub_request = request;
+
+    pub_request.op = HASHSIGD_OP_PUBKEY;
+    pub_request.len = 0;
+    if ((fd = hashsigd_connect(path)) < 0 || load_request(fd, &pub_request, NULL, &pub, &pub_len) != HASHSIGD_OK)
+    {
+      fprintf(stderr, "%s: Cannot get public key %u.\n", path, (unsigned)request.key);
+      return 1;
+    }
+    close(fd);
+  }
+
+  threads = calloc(connections, sizeof(load_thread_t));
+  ids = calloc(connections, sizeof(pthread_t));
+  latencies = calloc(requests, sizeof(double));
+
+  start = load_now();
+  for (i = 0, j = 0; i < connections; i++)
+  {
+    threads[i].path = path;
+    threads[i].index = i;
+    threads[i].request = request;
+    threads[i].requests = requests / connections + (i < requests % connections);
+    threads[i].verify = verify;
+    threads[i].pub = pub;
+    threads[i].pub_len = pub_len;
+    threads[i].latencies = latencies + j;
+    j += threads[i].requests;
+    pthread_create(&ids[i], NULL, load_thread, &threads[i]);
+  }
+
+  for (i = 0; i < connections; i++)
+    pthread_join(ids[i], NULL);
+  seconds = load_now() - start;
+
+  /* Collect the latencies of signed requests at the front. */
+  for (i = 0; i < connections; i++)
+  {
+    memmove(latencies + ok, threads[i].latencies, threads[i].counts[HASHSIGD_OK] * sizeof(double));
+    ok += threads[i].counts[HASHSIGD_OK];
+    for (j = 0; j <= HASHSIGD_INVALID; j++)
+      counts[j] += threads[i].counts[j];
+    bad += threads[i].bad;
+    failed |= threads[i].failed;
+  }
+  qsort(latencies, ok, sizeof(double), load_compare);
+
+  printf("Requests:    %zu over %zu connections in %.3f s\n", counts[HASHSIGD_OK] + counts[HASHSIGD_BUSY] + counts[HASHSIGD_EXPIRED] + counts[HASHSIGD_INVALID], connections, seconds);
+  printf("Signed:      %zu (%.2f signatures/s)\n", ok, ok / seconds);
+  printf("Busy:        %zu\n", counts[HASHSIGD_BUSY]);
+  printf("Expired:     %zu\n", counts[HASHSIGD_EXPIRED]);
+  printf("Invalid:     %zu\n", counts[HASHSIGD_INVALID]);
+  if (ok > 0)
+    printf("Latency:     p50 %.3f s, p99 %.3f s\n", latencies[ok / 2], latencies[(ok * 99) / 100]);
+  if (verify)
+    printf("Bad:         %zu\n", bad);
+  if (failed)
+    fprintf(stderr, "Some connections failed.\n");
+
+  free(latencies);
+  free(ids);
+  free(threads);
+  free(pub);
+
+  return (failed || bad) ? 1 : 0;
+}
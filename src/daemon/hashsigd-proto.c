@@ -0,0 +1,148 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Protocol helpers shared by hashsigd and its load generator */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "hashsigd.h"
+
+static void hashsigd_store_le (uint8_t *buf, uint64_t v, const size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++, v >>= 8)
+    buf[i] = v & 0xff;
+}
+
+static uint64_t hashsigd_load_le (const uint8_t *buf, const size_t len)
+{
+  uint64_t v = 0;
+  size_t i;
+
+  for (i = len; i > 0; i--)
+    v = (v << 8) | buf[i - 1];
+
+  return v;
+}
+
+void hashsigd_encode_request (uint8_t *buf, const hashsigd_request_t *request)
+{
+  memset(buf, 0, HASHSIGD_REQUEST_LEN);
+  buf[0] = HASHSIGD_VERSION;
+  buf[1] = request->op;
+  buf[2] = request->priority;
+  hashsigd_store_le(buf + 4, request->key, 2);
+  hashsigd_store_le(buf + 8, request->deadline, 4);
+  hashsigd_store_le(buf + 12, request->len, 8);
+}
+
+/* Returns non-zero if the version is not supported. */
+int hashsigd_decode_request (const uint8_t *buf, hashsigd_request_t *request)
+{
+  request->op = buf[1];
+  request->priority = buf[2];
+  request->key = hashsigd_load_le(buf + 4, 2);
+  request->deadline = hashsigd_load_le(buf + 8, 4);
+  request->len = hashsigd_load_le(buf + 12, 8);
+
+  return buf[0] != HASHSIGD_VERSION;
+}
+
+void hashsigd_encode_response (uint8_t *buf, const uint8_t status, const uint32_t len)
+{
+  memset(buf, 0, HASHSIGD_RESPONSE_LEN);
+  buf[0] = status;
+  hashsigd_store_le(buf + 4, len, 4);
+}
+
+int hashsigd_read (int fd, void *buf, size_t len)
+{
+  uint8_t *p = buf;
+  ssize_t got;
+
+  while (len > 0)
+  {
+    if ((got = read(fd, p, len)) < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return -1;
+    p += got;
+    len -= got;
+  }
+
+  return 0;
+}
+
+int hashsigd_write (int fd, const void *buf, size_t len)
+{
+  const uint8_t *p = buf;
+  ssize_t got;
+
+  while (len > 0)
+  {
+    if ((got = send(fd, p, len, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return -1;
+    p += got;
+    len -= got;
+  }
+
+  return 0;
+}
+
+int hashsigd_connect (const char *path)
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  if (strlen(path) >= sizeof(addr.sun_path))
+    return -1;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    return -1;
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+  {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
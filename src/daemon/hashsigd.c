@@ -0,0 +1,565 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Signing daemon
+ *
+ * Loads private keys once and signs messages sent over a Unix domain socket,
+ * see hashsigd.h for the protocol. A thread per connection reads requests into
+ * a priority queue, ordered by priority and deadline. A single batching thread
+ * takes up to -b requests for the same key at a time and signs them with
+ * hashsig_sign_batch, which calculates trees shared between the signatures of
+ * a batch only once and spreads the rest over the thread pool. While a batch
+ * is signed, new requests accumulate for the next one. Requests whose deadline
+ * has passed are answered with HASHSIGD_EXPIRED instead of being signed, and if
+ * -q requests are already queued, new ones are turned away with HASHSIGD_BUSY
+ * before their message is read. Connections beyond -c are answered with
+ * HASHSIGD_BUSY right away, so threads and memory stay bounded by -c and -m.
+ * On SIGINT or SIGTERM, queued requests are still signed, later ones get
+ * HASHSIGD_BUSY, and the keys are wiped once the batching thread has stopped.
+ *
+ * Private key files are in the format written by "hashsig keygen": a type byte
+ * followed by the private key. The first key file is key 0, and so on. */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "hashsig.h"
+#include "hashsigd.h"
+
+#define HASHSIGD_MAX_KEYS 64
+
+typedef struct
+{
+  hashsig_t *ctx;
+  uint8_t priv[64];
+  uint8_t pub[64];
+  size_t pub_len;
+} hashsigd_key_t;
+
+typedef struct
+{
+  uint8_t *message;
+  size_t len;
+  uint16_t key;
+  uint8_t priority;
+  uint64_t deadline; /* Monotonic time in nanoseconds, zero for none. */
+  uint64_t seq;
+  uint8_t *sig;
+  uint8_t status;
+  int done;
+  pthread_cond_t finished;
+} hashsigd_job_t;
+
+/* Binary heap of pending jobs, the most urgent at the root. */
+typedef struct
+{
+  hashsigd_job_t **jobs;
+  size_t count;
+  size_t size;
+} hashsigd_queue_t;
+
+static hashsigd_key_t keys[HASHSIGD_MAX_KEYS];
+static size_t keys_count, sig_len;
+static const hashsig_executor_t *executor;
+static size_t max_batch = 64, max_queue = 1024, max_len = 16 << 20, max_connections = 256, connections;
+static long window_ms = 2;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pending = PTHREAD_COND_INITIALIZER;
+static hashsigd_queue_t queue;
+static uint64_t seq;
+static volatile sig_atomic_t stop;
+static int closing; /* Set under lock on shutdown. New sign requests are turned away and the batcher exits once the queue is empty. */
+
+static uint64_t hashsigd_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Returns non-zero if job a is more urgent than job b. */
+static int hashsigd_before (const hashsigd_job_t *a, const hashsigd_job_t *b)
+{
+  if (a->priority != b->priority)
+    return a->priority > b->priority;
+  if (a->deadline != b->deadline)
+    return a->deadline != 0 && (b->deadline == 0 || a->deadline < b->deadline);
+  return a->seq < b->seq;
+}
+
+static void hashsigd_queue_push (hashsigd_queue_t *q, hashsigd_job_t *job)
+{
+  hashsigd_job_t *tmp;
+  size_t i = q->count++;
+
+  q->jobs[i] = job;
+  while (i > 0 && hashsigd_before(q->jobs[i], q->jobs[(i - 1) / 2]))
+  {
+    tmp = q->jobs[i];
+    q->jobs[i] = q->jobs[(i - 1) / 2];
+    q->jobs[(i - 1) / 2] = tmp;
+    i = (i - 1) / 2;
+  }
+}
+
+static hashsigd_job_t *hashsigd_queue_pop (hashsigd_queue_t *q)
+{
+  hashsigd_job_t *job = q->jobs[0], *tmp;
+  size_t i = 0, child;
+
+  q->jobs[0] = q->jobs[--q->count];
+  while ((child = 2 * i + 1) < q->count)
+  {
+    if (child + 1 < q->count && hashsigd_before(q->jobs[child + 1], q->jobs[child]))
+      child++;
+    if (!hashsigd_before(q->jobs[child], q->jobs[i]))
+      break;
+    tmp = q->jobs[i];
+    q->jobs[i] = q->jobs[child];
+    q->jobs[child] = tmp;
+    i = child;
+  }
+
+  return job;
+}
+
+/* Take the most urgent job and up to max_batch - 1 more for the same key, in order of urgency. Jobs for other keys stay queued. */
+static size_t hashsigd_take_batch (hashsigd_job_t **batch)
+{
+  hashsigd_job_t **others = calloc(queue.count, sizeof(hashsigd_job_t *));
+  size_t count = 0, other = 0;
+
+  batch[count++] = hashsigd_queue_pop(&queue);
+  while (queue.count > 0 && count < max_batch)
+  {
+    hashsigd_job_t *job = hashsigd_queue_pop(&queue);
+
+    if (job->key == batch[0]->key)
+      batch[count++] = job;
+    else
+      others[other++] = job;
+  }
+
+  while (other > 0)
+    hashsigd_queue_push(&queue, others[--other]);
+  free(others);
+
+  return count;
+}
+
+static void *hashsigd_batcher (void *arg)
+{
+  hashsigd_job_t **batch = calloc(max_batch, sizeof(hashsigd_job_t *));
+  const uint8_t **messages = calloc(max_batch, sizeof(uint8_t *));
+  uint8_t **sigs = calloc(max_batch, sizeof(uint8_t *));
+  size_t *lens = calloc(max_batch, sizeof(size_t));
+  struct timespec until;
+  size_t count, n, i;
+  uint64_t now;
+
+  pthread_mutex_lock(&lock);
+  for (;;)
+  {
+    while (queue.count == 0 && !closing)
+      pthread_cond_wait(&pending, &lock);
+    if (queue.count == 0)
+      break;
+
+    /* Give concurrent requests a moment to join a batch that is not full yet. */
+    if (window_ms > 0 && queue.count < max_batch)
+    {
+      clock_gettime(CLOCK_REALTIME, &until);
+      until.tv_nsec += window_ms * 1000000;
+      until.tv_sec += until.tv_nsec / 1000000000;
+      until.tv_nsec %= 1000000000;
+      while (queue.count < max_batch && pthread_cond_timedwait(&pending, &lock, &until) != ETIMEDOUT)
+        ;
+    }
+
+    count = hashsigd_take_batch(batch);
+    pthread_mutex_unlock(&lock);
+
+    now = hashsigd_now();
+    for (i = 0, n = 0; i < count; i++)
+    {
+      if (batch[i]->deadline != 0 && batch[i]->deadline < now)
+      {
+        batch[i]->status = HASHSIGD_EXPIRED;
+        continue;
+      }
+      batch[i]->sig = malloc(sig_len);
+      messages[n] = batch[i]->message;
+      lens[n] = batch[i]->len;
+      sigs[n++] = batch[i]->sig;
+    }
+
+    if (n > 0)
+      hashsig_sign_batch(keys[batch[0]->key].ctx, messages, lens, n, sigs, sig_len, executor);
+
+    pthread_mutex_lock(&lock);
+    for (i = 0; i < count; i++)
+    {
+      batch[i]->done = 1;
+      pthread_cond_signal(&batch[i]->finished);
+    }
+  }
+  pthread_mutex_unlock(&lock);
+
+  free(batch);
+  free(messages);
+  free(sigs);
+  free(lens);
+
+  return arg;
+}
+
+static int hashsigd_respond (int fd, const uint8_t status, const uint8_t *data, const size_t len)
+{
+  uint8_t header[HASHSIGD_RESPONSE_LEN];
+
+  hashsigd_encode_response(header, status, len);
+  return hashsigd_write(fd, header, sizeof(header)) || (len > 0 && hashsigd_write(fd, data, len));
+}
+
+/* Queue a sign request and wait for the batching thread to finish it. */
+static int hashsigd_sign (int fd, const hashsigd_request_t *request, uint8_t *message)
+{
+  hashsigd_job_t job;
+  int ret;
+
+  memset(&job, 0, sizeof(job));
+  job.message = message;
+  job.len = request->len;
+  job.key = request->key;
+  job.priority = request->priority;
+  if (request->deadline != 0)
+    job.deadline = hashsigd_now() + (uint64_t)request->deadline * 1000000;
+  job.status = HASHSIGD_OK;
+  pthread_cond_init(&job.finished, NULL);
+
+  pthread_mutex_lock(&lock);
+  if (closing || queue.count >= max_queue)
+  {
+    pthread_mutex_unlock(&lock);
+    pthread_cond_destroy(&job.finished);
+    return hashsigd_respond(fd, HASHSIGD_BUSY, NULL, 0);
+  }
+  job.seq = seq++;
+  hashsigd_queue_push(&queue, &job);
+  pthread_cond_signal(&pending);
+  while (!job.done)
+    pthread_cond_wait(&job.finished, &lock);
+  pthread_mutex_unlock(&lock);
+  pthread_cond_destroy(&job.finished);
+
+  if (job.status == HASHSIGD_OK)
+    ret = hashsigd_respond(fd, HASHSIGD_OK, job.sig, sig_len);
+  else
+    ret = hashsigd_respond(fd, job.status, NULL, 0);
+  free(job.sig);
+
+  return ret;
+}
+
+static int hashsigd_queue_full (void)
+{
+  int full;
+
+  pthread_mutex_lock(&lock);
+  full = queue.count >= max_queue;
+  pthread_mutex_unlock(&lock);
+
+  return full;
+}
+
+static void *hashsigd_connection (void *arg)
+{
+  int fd = (int)(intptr_t)arg;
+  uint8_t header[HASHSIGD_REQUEST_LEN];
+  hashsigd_request_t request;
+  uint8_t *message;
+  int ret = 0;
+
+  while (!ret && !hashsigd_read(fd, header, sizeof(header)))
+  {
+    /* Unknown versions and oversized messages cannot be skipped safely, so the connection is closed after answering. */
+    if (hashsigd_decode_request(header, &request) || request.len > max_len)
+    {
+      hashsigd_respond(fd, HASHSIGD_INVALID, NULL, 0);
+      break;
+    }
+
+    /* Turn sign requests away before allocating their message. It is not read then, so the connection is closed as well. */
+    if (request.op == HASHSIGD_OP_SIGN && hashsigd_queue_full())
+    {
+      hashsigd_respond(fd, HASHSIGD_BUSY, NULL, 0);
+      break;
+    }
+
+    if ((message = malloc(request.len + 1)) == NULL || hashsigd_read(fd, message, request.len))
+    {
+      free(message);
+      break;
+    }
+
+    if (request.key >= keys_count)
+      ret = hashsigd_respond(fd, HASHSIGD_INVALID, NULL, 0);
+    else if (request.op == HASHSIGD_OP_PUBKEY)
+      ret = hashsigd_respond(fd, HASHSIGD_OK, keys[request.key].pub, keys[request.key].pub_len);
+    else if (request.op == HASHSIGD_OP_SIGN)
+      ret = hashsigd_sign(fd, &request, message);
+    else
+      ret = hashsigd_respond(fd, HASHSIGD_INVALID, NULL, 0);
+
+    free(message);
+  }
+
+  close(fd);
+
+  pthread_mutex_lock(&lock);
+  connections--;
+  pthread_mutex_unlock(&lock);
+
+  return NULL;
+}
+
+static int hashsigd_load_key (hashsigd_key_t *key, const char *path)
+{
+  uint8_t buf[1 + sizeof(key->priv) + 1];
+  hashsig_pub_t *pub;
+  size_t priv_len;
+  uint32_t type;
+  ssize_t got;
+  int fd;
+
+  if ((fd = open(path, O_RDONLY)) < 0)
+  {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  got = read(fd, buf, sizeof(buf));
+  close(fd);
+
+  type = got > 0 ? buf[0] : 0;
+  priv_len = hashsig_private_key_length_type(type);
+  if (got != (ssize_t)priv_len + 1)
+  {
+    fprintf(stderr, "%s: Not a private key.\n", path);
+    return -1;
+  }
+  memcpy(key->priv, buf + 1, priv_len);
+  memset(buf, 0, sizeof(buf));
+
+  if ((key->ctx = hashsig_create_context_parallel(type, key->priv, priv_len, NULL, executor)) == NULL)
+  {
+    fprintf(stderr, "%s: Unsupported type.\n", path);
+    return -1;
+  }
+
+  pub = hashsig_get_public_key(key->ctx);
+  key->pub_len = hashsig_public_key_length(key->ctx);
+  hashsig_pub2buf(pub, key->pub, sizeof(key->pub));
+  hashsig_free(pub);
+
+  return 0;
+}
+
+static void hashsigd_stop (int sig)
+{
+  stop = 1;
+}
+
+static void usage (const char *name)
+{
+  fprintf(stderr, "Usage: %s -s socket [-j threads] [-b batch] [-q queue] [-c connections] [-w milliseconds] [-m bytes] PRIVATE...\n", name);
+  fprintf(stderr, "  -s socket        Path of the Unix domain socket to listen on\n");
+  fprintf(stderr, "  -j threads       Number of signing threads (default: online CPUs)\n");
+  fprintf(stderr, "  -b batch         Maximum number of signatures per batch (default 64)\n");
+  fprintf(stderr, "  -q queue         Maximum number of queued requests before turning new ones away (default 1024)\n");
+  fprintf(stderr, "  -c connections   Maximum number of open connections before turning new ones away (default 256)\n");
+  fprintf(stderr, "  -w milliseconds  Time to wait for more requests to join a batch (default 2)\n");
+  fprintf(stderr, "  -m bytes         Maximum message length (default 16 MiB)\n");
+}
+
+int main (int argc, char *argv[])
+{
+  hashsig_executor_t pool_executor;
+  hashsig_pool_t *pool = NULL;
+  struct sockaddr_un addr;
+  struct sigaction sa;
+  pthread_attr_t attr;
+  pthread_t thread, batcher;
+  const char *path = NULL;
+  long threads = 0;
+  int c, fd, client;
+  size_t i;
+
+  while ((c = getopt(argc, argv, "s:j:b:q:c:w:m:h")) != -1)
+  {
+    switch (c)
+    {
+      case 's':
+        path = optarg;
+        break;
+      case 'j':
+        threads = strtol(optarg, NULL, 0);
+        break;
+      case 'b':
+        max_batch = strtoul(optarg, NULL, 0);
+        break;
+      case 'q':
+        max_queue = strtoul(optarg, NULL, 0);
+        break;
+      case 'c':
+        max_connections = strtoul(optarg, NULL, 0);
+        break;
+      case 'w':
+        window_ms = strtol(optarg, NULL, 0);
+        break;
+      case 'm':
+        max_len = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (path == NULL || optind >= argc || argc - optind > HASHSIGD_MAX_KEYS || threads < 0 || max_batch < 1 || max_queue < 1 || max_connections < 1 || window_ms < 0 || window_ms >= 1000 || strlen(path) >= sizeof(addr.sun_path))
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (threads > 0 && (pool = hashsig_pool_create(threads)) != NULL)
+  {
+    hashsig_pool_executor(pool, &pool_executor);
+    executor = &pool_executor;
+  }
+
+  /* Keep private keys from being swapped out, where the limit of locked memory allows. */
+  mlock(keys, sizeof(keys));
+  for (i = 0; optind + i < (size_t)argc; i++)
+    if (hashsigd_load_key(&keys[i], argv[optind + i]))
+      return 1;
+  keys_count = i;
+  sig_len = hashsig_signature_length(keys[0].ctx);
+
+  queue.size = max_queue;
+  queue.jobs = calloc(queue.size, sizeof(hashsigd_job_t *));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  unlink(path);
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, 128))
+  {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return 1;
+  }
+
+  /* No SA_RESTART, so accept returns when asked to stop. */
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = hashsigd_stop;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  if (pthread_create(&batcher, NULL, hashsigd_batcher, NULL))
+  {
+    fprintf(stderr, "Cannot start batching thread.\n");
+    return 1;
+  }
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  while (!stop)
+  {
+    if ((client = accept(fd, NULL, NULL)) < 0)
+      continue;
+
+    /* Answer before reading anything, the response fits into the socket buffer of a new connection. */
+    pthread_mutex_lock(&lock);
+    if (connections >= max_connections)
+    {
+      pthread_mutex_unlock(&lock);
+      hashsigd_respond(client, HASHSIGD_BUSY, NULL, 0);
+      close(client);
+      continue;
+    }
+    connections++;
+    pthread_mutex_unlock(&lock);
+
+    if (pthread_create(&thread, &attr, hashsigd_connection, (void *)(intptr_t)client))
+    {
+      close(client);
+      pthread_mutex_lock(&lock);
+      connections--;
+      pthread_mutex_unlock(&lock);
+    }
+  }
+
+  close(fd);
+  unlink(path);
+
+  /* Let the batcher finish queued requests and wait for it, as contexts sign with the key buffers. Connections still open only get BUSY from now on. */
+  pthread_mutex_lock(&lock);
+  closing = 1;
+  pthread_cond_signal(&pending);
+  pthread_mutex_unlock(&lock);
+  pthread_join(batcher, NULL);
+
+  for (i = 0; i < keys_count; i++)
+  {
+    hashsig_destroy_context(keys[i].ctx);
+    memset(keys[i].priv, 0, sizeof(keys[i].priv));
+  }
+  __sync_synchronize();
+  munlock(keys, sizeof(keys));
+  if (pool != NULL)
+    hashsig_pool_destroy(pool);
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef HASHSIGD_H
+#define HASHSIGD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Protocol of hashsigd over a Unix domain stream socket. Each connection sends one request at a time and reads its response before the next. Integers are little endian.
+ *
+ * Request:  version (1), op (1), priority (1), reserved (1), key (2), reserved (2), deadline in milliseconds after receipt or zero for none (4), message length (8), message
+ * Response: status (1), reserved (3), data length (4), data: the signature for HASHSIGD_OP_SIGN, the public key for HASHSIGD_OP_PUBKEY
+ *
+ * Requests with higher priority are signed first, then those with the earliest deadline. Read the response even if sending the request fails, the daemon may have answered and closed the connection early. */
+#define HASHSIGD_VERSION 1
+#define HASHSIGD_REQUEST_LEN 20
+#define HASHSIGD_RESPONSE_LEN 8
+
+#define HASHSIGD_OP_SIGN   1
+#define HASHSIGD_OP_PUBKEY 2
+
+#define HASHSIGD_OK      0
+#define HASHSIGD_BUSY    1 /* Queue full, too many connections or shutting down, try again later on a new connection. The connection may be closed before the request is read. */
+#define HASHSIGD_EXPIRED 2 /* Deadline passed before signing started. */
+#define HASHSIGD_INVALID 3 /* Unknown key, op or version, or message too long. */
+
+typedef struct
+{
+  uint8_t op;
+  uint8_t priority;
+  uint16_t key;
+  uint32_t deadline;
+  uint64_t len;
+} hashsigd_request_t;
+
+void hashsigd_encode_request (uint8_t *buf, const hashsigd_request_t *request);
+int hashsigd_decode_request (const uint8_t *buf, hashsigd_request_t *request);
+void hashsigd_encode_response (uint8_t *buf, const uint8_t status, const uint32_t len);
+
+/* Read or write exactly len bytes, retrying after interruptions. Return zero on success. */
+int hashsigd_read (int fd, void *buf, size_t len);
+int hashsigd_write (int fd, const void *buf, size_t len);
+
+/* Connect to the daemon listening at path. Returns the socket or -1. */
+int hashsigd_connect (const char *path);
+
+#endif /* HASHSIGD_H */
@@ -0,0 +1,471 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Verification engine */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef HASHSIG_THREADS
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#include "hashsig_defs.h"
+#include "hashsig.h"
+#include "ldwm_defs.h"
+#include "lmfs_defs.h"
+#include "util.h"
+
+#ifdef HASHSIG_THREADS
+
+/* Jobs taken from a queue at once. With a multi-lane hash function, the chains of one verification already fill its lanes, so this mainly amortizes locking. */
+#define HASHSIG_ENGINE_BATCH HASHSIG_MAX_LANES
+
+/* Hash function families, by the upper bits of the type. */
+#define HASHSIG_ENGINE_FAMILIES 8
+
+typedef struct
+{
+  hashsig_pub_view_t pub;
+  hashsig_sig_view_t sig;
+  const uint8_t *message;
+  size_t len;
+  int *result;
+  void *tag;
+} hashsig_engine_job_t;
+
+/* Queue of a worker, a ring buffer growing as needed. The worker takes jobs from the front, thieves take half of them from the back. */
+typedef struct
+{
+  pthread_mutex_t lock;
+  hashsig_engine_job_t *jobs;
+  size_t head;
+  size_t count;
+  size_t size;
+  int cpu;
+  int node;
+  size_t *victims;
+  hashsig_engine_t *engine;
+  pthread_t thread;
+  hashsig_t ctx[HASHSIG_ENGINE_FAMILIES];
+} hashsig_engine_worker_t;
+
+struct hashsig_engine_s
+{
+  hashsig_engine_worker_t *workers;
+  size_t worker_count;
+  size_t started;
+  void (*callback) (void *user, void *tag, const int valid);
+  void *user;
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t idle;
+  size_t queued;
+  uint64_t submitted;
+  uint64_t completed;
+  uint64_t stolen;
+  size_t next;
+  uint64_t start;
+  int stop;
+};
+
+static uint64_t hashsig_engine_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* NUMA node of a CPU from sysfs, or zero if unknown. */
+static int hashsig_engine_node (const int cpu)
+{
+  char path[96];
+  int node;
+
+  for (node = 0; node < 64; node++)
+  {
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d", cpu, node);
+    if (access(path, F_OK) == 0)
+      return node;
+  }
+
+  return 0;
+}
+
+static void hashsig_engine_push (hashsig_engine_worker_t *worker, const hashsig_engine_job_t *job)
+{
+  hashsig_engine_job_t *jobs;
+  size_t i, size;
+
+  if (worker->count == worker->size)
+  {
+    size = worker->size * 2;
+    jobs = hashsig_calloc(size, sizeof(hashsig_engine_job_t));
+    for (i = 0; i < worker->count; i++)
+      jobs[i] = worker->jobs[(worker->head + i) % worker->size];
+    hashsig_free(worker->jobs);
+    worker->jobs = jobs;
+    worker->head = 0;
+    worker->size = size;
+  }
+
+  worker->jobs[(worker->head + worker->count++) % worker->size] = *job;
+}
+
+/* Take up to max jobs from the front of the own queue. */
+static size_t hashsig_engine_pop (hashsig_engine_worker_t *worker, hashsig_engine_job_t *jobs, const size_t max)
+{
+  size_t n;
+
+  pthread_mutex_lock(&worker->lock);
+  for (n = 0; n < max && worker->count > 0; n++)
+  {
+    jobs[n] = worker->jobs[worker->head];
+    worker->head = (worker->head + 1) % worker->size;
+    worker->count--;
+  }
+  pthread_mutex_unlock(&worker->lock);
+
+  return n;
+}
+
+/* Move half of the jobs of the first victim having any to the own queue, trying workers on the same node first. Returns the number of jobs moved. */
+static size_t hashsig_engine_steal (hashsig_engine_worker_t *worker)
+{
+  hashsig_engine_t *engine = worker->engine;
+  hashsig_engine_worker_t *victim;
+  hashsig_engine_job_t job;
+  size_t i, n, taken;
+
+  for (i = 0; i + 1 < engine->worker_count; i++)
+  {
+    victim = &engine->workers[worker->victims[i]];
+
+    /* Locks are taken one at a time, so two thieves stealing from each other cannot deadlock. */
+    for (taken = 0, n = 0; ; taken++)
+    {
+      pthread_mutex_lock(&victim->lock);
+      if (taken == 0)
+        n = (victim->count + 1) / 2;
+      if (taken == n || victim->count == 0)
+      {
+        pthread_mutex_unlock(&victim->lock);
+        break;
+      }
+      job = victim->jobs[(victim->head + --victim->count) % victim->size];
+      pthread_mutex_unlock(&victim->lock);
+
+      pthread_mutex_lock(&worker->lock);
+      hashsig_engine_push(worker, &job);
+      pthread_mutex_unlock(&worker->lock);
+    }
+
+    if (taken > 0)
+    {
+      pthread_mutex_lock(&engine->lock);
+      engine->stolen += taken;
+      pthread_mutex_unlock(&engine->lock);
+      return taken;
+    }
+  }
+
+  return 0;
+}
+
+/* Verify like hashsig_verify_view, with a context per hash function family kept by the worker. */
+static int hashsig_engine_verify (hashsig_engine_worker_t *worker, const hashsig_engine_job_t *job)
+{
+  const hashsig_backend_t *backend = hashsig_backend(job->pub.type);
+  hashsig_t *ctx;
+
+  if (backend == NULL || job->pub.type > 0xff || (job->pub.type & ~HASHSIG_FAMILY_MASK) != LMFS_TYPE_PARAMS || job->pub.type != job->sig.type || job->pub.len != LDWM_N + 1 || job->sig.len != LMFS_SIG_LEN)
+    return -1;
+
+  ctx = &worker->ctx[(job->pub.type & HASHSIG_FAMILY_MASK) >> 5];
+  if (ctx->hash_ctx == NULL)
+  {
+    /* Allocated by the worker itself, so that the memory is local to its node. */
+    if ((ctx->hash_ctx = hashsig_alloc(NULL, backend->ctx_size, 64)) == NULL)
+      return -1;
+    ctx->backend = backend;
+  }
+  ctx->type = job->pub.type;
+
+  return hashsig_lmfs_verify(ctx, job->pub.data, job->sig.data, job->message, job->len);
+}
+
+static void *hashsig_engine_thread (void *arg)
+{
+  hashsig_engine_worker_t *worker = arg;
+  hashsig_engine_t *engine = worker->engine;
+  hashsig_engine_job_t jobs[HASHSIG_ENGINE_BATCH];
+  size_t n, i;
+  int valid;
+
+#ifdef __linux__
+  if (worker->cpu >= 0)
+  {
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(worker->cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+#endif
+
+  for (;;)
+  {
+    if ((n = hashsig_engine_pop(worker, jobs, HASHSIG_ENGINE_BATCH)) == 0 && hashsig_engine_steal(worker) > 0)
+      n = hashsig_engine_pop(worker, jobs, HASHSIG_ENGINE_BATCH);
+
+    if (n > 0)
+    {
+      pthread_mutex_lock(&engine->lock);
+      engine->queued -= n;
+      pthread_mutex_unlock(&engine->lock);
+
+      for (i = 0; i < n; i++)
+      {
+        valid = hashsig_engine_verify(worker, &jobs[i]);
+        if (jobs[i].result != NULL)
+          *jobs[i].result = valid;
+        if (engine->callback != NULL)
+          engine->callback(engine->user, jobs[i].tag, valid);
+      }
+
+      pthread_mutex_lock(&engine->lock);
+      engine->completed += n;
+      if (engine->completed == engine->submitted)
+        pthread_cond_broadcast(&engine->idle);
+      pthread_mutex_unlock(&engine->lock);
+      continue;
+    }
+
+    /* Jobs counted as queued may just be moving between queues, so only sleep when there are none. */
+    pthread_mutex_lock(&engine->lock);
+    while (engine->queued == 0 && !engine->stop)
+      pthread_cond_wait(&engine->work, &engine->lock);
+    if (engine->queued == 0 && engine->stop)
+    {
+      pthread_mutex_unlock(&engine->lock);
+      break;
+    }
+    pthread_mutex_unlock(&engine->lock);
+  }
+
+  for (i = 0; i < HASHSIG_ENGINE_FAMILIES; i++)
+    if (worker->ctx[i].hash_ctx != NULL)
+      hashsig_dealloc(NULL, worker->ctx[i].hash_ctx, worker->ctx[i].backend->ctx_size);
+
+  return NULL;
+}
+
+hashsig_engine_t *hashsig_engine_create (size_t threads, void (*callback) (void *user, void *tag, const int valid), void *user)
+{
+  hashsig_engine_t *engine;
+  hashsig_engine_worker_t *worker;
+  int cpus[1024];
+  size_t cpu_count = 0, i, j, n;
+#ifdef __linux__
+  cpu_set_t set;
+
+  /* Workers are pinned to the CPUs the process may run on, if there are enough. */
+  if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    for (i = 0; i < CPU_SETSIZE && cpu_count < sizeof(cpus) / sizeof(cpus[0]); i++)
+      if (CPU_ISSET(i, &set))
+        cpus[cpu_count++] = i;
+#endif
+
+  if (threads == 0)
+  {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+    threads = (cpu_count > 0) ? cpu_count : (online > 0) ? (size_t)online : 1;
+  }
+
+  engine = hashsig_calloc(1, sizeof(hashsig_engine_t));
+  engine->workers = hashsig_calloc(threads, sizeof(hashsig_engine_worker_t));
+  engine->worker_count = threads;
+  engine->callback = callback;
+  engine->user = user;
+  engine->start = hashsig_engine_now();
+  pthread_mutex_init(&engine->lock, NULL);
+  pthread_cond_init(&engine->work, NULL);
+  pthread_cond_init(&engine->idle, NULL);
+
+  for (i = 0; i < threads; i++)
+  {
+    worker = &engine->workers[i];
+    pthread_mutex_init(&worker->lock, NULL);
+    worker->size = 64;
+    worker->jobs = hashsig_calloc(worker->size, sizeof(hashsig_engine_job_t));
+    worker->cpu = (threads <= cpu_count) ? cpus[i] : -1;
+    worker->node = (worker->cpu >= 0) ? hashsig_engine_node(worker->cpu) : 0;
+    worker->engine = engine;
+  }
+
+  /* Victims on the same node come first, each list starting after the worker itself to spread thieves. */
+  for (i = 0; i < threads; i++)
+  {
+    worker = &engine->workers[i];
+    worker->victims = hashsig_calloc(threads, sizeof(size_t));
+    n = 0;
+    for (j = 1; j < threads; j++)
+      if (engine->workers[(i + j) % threads].node == worker->node)
+        worker->victims[n++] = (i + j) % threads;
+    for (j = 1; j < threads; j++)
+      if (engine->workers[(i + j) % threads].node != worker->node)
+        worker->victims[n++] = (i + j) % threads;
+  }
+
+  for (engine->started = 0; engine->started < threads; engine->started++)
+    if (pthread_create(&engine->workers[engine->started].thread, NULL, hashsig_engine_thread, &engine->workers[engine->started]))
+      break;
+
+  if (engine->started < threads)
+  {
+    hashsig_engine_destroy(engine);
+    return NULL;
+  }
+
+  return engine;
+}
+
+int hashsig_engine_submit (hashsig_engine_t *engine, const hashsig_pub_view_t *pub, const hashsig_sig_view_t *sig, const uint8_t *message, const size_t len, int *result, void *tag)
+{
+  hashsig_engine_worker_t *worker;
+  hashsig_engine_job_t job;
+
+  job.pub = *pub;
+  job.sig = *sig;
+  job.message = message;
+  job.len = len;
+  job.result = result;
+  job.tag = tag;
+
+  /* Count the job before any worker can see it, so it cannot be finished before it is submitted. */
+  pthread_mutex_lock(&engine->lock);
+  engine->submitted++;
+  engine->queued++;
+  pthread_mutex_unlock(&engine->lock);
+
+  /* Spread jobs round-robin, thieves balance the rest. */
+  worker = &engine->workers[__sync_fetch_and_add(&engine->next, 1) % engine->worker_count];
+  pthread_mutex_lock(&worker->lock);
+  hashsig_engine_push(worker, &job);
+  pthread_mutex_unlock(&worker->lock);
+
+  pthread_mutex_lock(&engine->lock);
+  pthread_cond_signal(&engine->work);
+  pthread_mutex_unlock(&engine->lock);
+
+  return 0;
+}
+
+void hashsig_engine_wait (hashsig_engine_t *engine)
+{
+  pthread_mutex_lock(&engine->lock);
+  while (engine->completed != engine->submitted)
+    pthread_cond_wait(&engine->idle, &engine->lock);
+  pthread_mutex_unlock(&engine->lock);
+}
+
+void hashsig_engine_get_stats (hashsig_engine_t *engine, hashsig_engine_stats_t *stats)
+{
+  uint64_t ns = hashsig_engine_now() - engine->start;
+
+  pthread_mutex_lock(&engine->lock);
+  stats->submitted = engine->submitted;
+  stats->completed = engine->completed;
+  stats->queued = engine->queued;
+  stats->stolen = engine->stolen;
+  pthread_mutex_unlock(&engine->lock);
+  stats->workers = engine->worker_count;
+  stats->jobs_per_second = (ns > 0) ? stats->completed * 1e9 / ns : 0;
+}
+
+void hashsig_engine_destroy (hashsig_engine_t *engine)
+{
+  size_t i;
+
+  hashsig_engine_wait(engine);
+
+  pthread_mutex_lock(&engine->lock);
+  engine->stop = 1;
+  pthread_cond_broadcast(&engine->work);
+  pthread_mutex_unlock(&engine->lock);
+
+  for (i = 0; i < engine->started; i++)
+    pthread_join(engine->workers[i].thread, NULL);
+
+  for (i = 0; i < engine->worker_count; i++)
+  {
+    pthread_mutex_destroy(&engine->workers[i].lock);
+    hashsig_free(engine->workers[i].jobs);
+    hashsig_free(engine->workers[i].victims);
+  }
+  pthread_cond_destroy(&engine->idle);
+  pthread_cond_destroy(&engine->work);
+  pthread_mutex_destroy(&engine->lock);
+  hashsig_free(engine->workers);
+  hashsig_free(engine);
+}
+
+#else
+
+hashsig_engine_t *hashsig_engine_create (size_t threads, void (*callback) (void *user, void *tag, const int valid), void *user)
+{
+  return NULL;
+}
+
+int hashsig_engine_submit (hashsig_engine_t *engine, const hashsig_pub_view_t *pub, const hashsig_sig_view_t *sig, const uint8_t *message, const size_t len, int *result, void *tag)
+{
+  return -1;
+}
+
+void hashsig_engine_wait (hashsig_engine_t *engine)
+{
+}
+
+void hashsig_engine_get_stats (hashsig_engine_t *engine, hashsig_engine_stats_t *stats)
+{
+  memset(stats, 0, sizeof(hashsig_engine_stats_t));
+}
+
+void hashsig_engine_destroy (hashsig_engine_t *engine)
+{
+}
+
+#endif
@@ -0,0 +1,339 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Executors and the default thread pool */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HASHSIG_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "hashsig.h"
+#include "util.h"
+#include "executor.h"
+
+typedef struct
+{
+  void (*fn) (void *arg);
+  void *arg;
+  const hashsig_executor_t *executor;
+  void *wait_group;
+} hashsig_task_t;
+
+static void hashsig_task_run (void *arg)
+{
+  hashsig_task_t *task = arg;
+
+  task->fn(task->arg);
+  task->executor->wait_group_done(task->executor->opaque, task->wait_group);
+}
+
+void hashsig_run_tasks (const hashsig_executor_t *executor, void (*fn) (void *arg), void *args, const size_t arg_size, const size_t tasks)
+{
+  hashsig_task_t *task;
+  void *wait_group = NULL;
+  size_t i;
+
+  if (executor != NULL && tasks > 1)
+    wait_group = executor->wait_group_create(executor->opaque, tasks);
+
+  if (wait_group == NULL)
+  {
+    for (i = 0; i < tasks; i++)
+      fn((uint8_t *)args + i * arg_size);
+    return;
+  }
+
+  task = hashsig_calloc(tasks, sizeof(hashsig_task_t));
+  for (i = 0; i < tasks; i++)
+  {
+    task[i].fn = fn;
+    task[i].arg = (uint8_t *)args + i * arg_size;
+    task[i].executor = executor;
+    task[i].wait_group = wait_group;
+
+    /* Run tasks the executor does not accept on the calling thread. */
+    if (executor->submit(executor->opaque, hashsig_task_run, &task[i]))
+      hashsig_task_run(&task[i]);
+  }
+
+  executor->wait_group_wait(executor->opaque, wait_group);
+  hashsig_free(task);
+}
+
+size_t hashsig_executor_concurrency (const hashsig_executor_t *executor)
+{
+  if (executor == NULL || executor->concurrency < 1)
+    return 1;
+  return executor->concurrency;
+}
+
+#ifdef HASHSIG_THREADS
+
+typedef struct hashsig_pool_job_s
+{
+  void (*task) (void *arg);
+  void *arg;
+  struct hashsig_pool_job_s *next;
+} hashsig_pool_job_t;
+
+struct hashsig_pool_s
+{
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t done;
+  hashsig_pool_job_t *head;
+  hashsig_pool_job_t *tail;
+  pthread_t *threads;
+  size_t thread_count;
+  int stop;
+};
+
+/* Take the next job. Called with the lock held. */
+static hashsig_pool_job_t *hashsig_pool_pop (hashsig_pool_t *pool)
+{
+  hashsig_pool_job_t *job = pool->head;
+
+  if (job != NULL)
+  {
+    pool->head = job->next;
+    if (pool->head == NULL)
+      pool->tail = NULL;
+  }
+
+  return job;
+}
+
+/* Run a job without holding the lock. */
+static void hashsig_pool_run (hashsig_pool_t *pool, hashsig_pool_job_t *job)
+{
+  pthread_mutex_unlock(&pool->lock);
+  job->task(job->arg);
+  hashsig_free(job);
+  pthread_mutex_lock(&pool->lock);
+}
+
+static void *hashsig_pool_thread (void *arg)
+{
+  hashsig_pool_t *pool = arg;
+  hashsig_pool_job_t *job;
+
+  pthread_mutex_lock(&pool->lock);
+  while (!pool->stop)
+  {
+    if ((job = hashsig_pool_pop(pool)) != NULL)
+      hashsig_pool_run(pool, job);
+    else
+      pthread_cond_wait(&pool->work, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+static int hashsig_pool_submit (void *opaque, void (*task) (void *arg), void *arg)
+{
+  hashsig_pool_t *pool = opaque;
+  hashsig_pool_job_t *job = hashsig_calloc(1, sizeof(hashsig_pool_job_t));
+
+  job->task = task;
+  job->arg = arg;
+
+  pthread_mutex_lock(&pool->lock);
+  if (pool->tail != NULL)
+    pool->tail->next = job;
+  else
+    pool->head = job;
+  pool->tail = job;
+  pthread_cond_signal(&pool->work);
+  pthread_cond_broadcast(&pool->done); /* Threads waiting for a wait group also run jobs. */
+  pthread_mutex_unlock(&pool->lock);
+
+  return 0;
+}
+
+/* Wait groups are counters protected by the pool lock. */
+static void *hashsig_pool_wait_group_create (void *opaque, const size_t tasks)
+{
+  size_t *remaining = hashsig_calloc(1, sizeof(size_t));
+
+  *remaining = tasks;
+  return remaining;
+}
+
+static void hashsig_pool_wait_group_done (void *opaque, void *wait_group)
+{
+  hashsig_pool_t *pool = opaque;
+  size_t *remaining = wait_group;
+
+  pthread_mutex_lock(&pool->lock);
+  if (--*remaining == 0)
+    pthread_cond_broadcast(&pool->done);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/* The waiting thread runs queued jobs itself, so waiting from within a job cannot deadlock the pool. */
+static void hashsig_pool_wait_group_wait (void *opaque, void *wait_group)
+{
+  hashsig_pool_t *pool = opaque;
+  size_t *remaining = wait_group;
+  hashsig_pool_job_t *job;
+
+  pthread_mutex_lock(&pool->lock);
+  while (*remaining > 0)
+  {
+    if ((job = hashsig_pool_pop(pool)) != NULL)
+      hashsig_pool_run(pool, job);
+    else
+      pthread_cond_wait(&pool->done, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  hashsig_free(remaining);
+}
+
+hashsig_pool_t *hashsig_pool_create (size_t threads)
+{
+  hashsig_pool_t *pool;
+  long cpus;
+
+  if (threads == 0)
+  {
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (cpus > 0) ? (size_t)cpus : 1;
+  }
+
+  pool = hashsig_calloc(1, sizeof(hashsig_pool_t));
+  pool->threads = hashsig_calloc(threads, sizeof(pthread_t));
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work, NULL);
+  pthread_cond_init(&pool->done, NULL);
+
+  for (pool->thread_count = 0; pool->thread_count < threads; pool->thread_count++)
+    if (pthread_create(&pool->threads[pool->thread_count], NULL, hashsig_pool_thread, pool))
+      break;
+
+  if (pool->thread_count == 0)
+  {
+    hashsig_pool_destroy(pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+void hashsig_pool_destroy (hashsig_pool_t *pool)
+{
+  hashsig_pool_job_t *job;
+  size_t i;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = 1;
+  pthread_cond_broadcast(&pool->work);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (i = 0; i < pool->thread_count; i++)
+    pthread_join(pool->threads[i], NULL);
+
+  while ((job = hashsig_pool_pop(pool)) != NULL)
+    hashsig_free(job);
+
+  pthread_cond_destroy(&pool->done);
+  pthread_cond_destroy(&pool->work);
+  pthread_mutex_destroy(&pool->lock);
+  hashsig_free(pool->threads);
+  hashsig_free(pool);
+}
+
+void hashsig_pool_executor (hashsig_pool_t *pool, hashsig_executor_t *executor)
+{
+  executor->submit = hashsig_pool_submit;
+  executor->wait_group_create = hashsig_pool_wait_group_create;
+  executor->wait_group_done = hashsig_pool_wait_group_done;
+  executor->wait_group_wait = hashsig_pool_wait_group_wait;
+  executor->concurrency = pool->thread_count + 1; /* The waiting thread helps. */
+  executor->opaque = pool;
+}
+
+/* The default pool is started on first use and kept until the process exits. */
+static pthread_once_t hashsig_default_once = PTHREAD_ONCE_INIT;
+static hashsig_executor_t hashsig_default_executor;
+static int hashsig_default_available;
+
+static void hashsig_default_init (void)
+{
+  hashsig_pool_t *pool = hashsig_pool_create(0);
+
+  if (pool != NULL)
+  {
+    hashsig_pool_executor(pool, &hashsig_default_executor);
+    hashsig_default_available = 1;
+  }
+}
+
+const hashsig_executor_t *hashsig_executor (const hashsig_executor_t *executor)
+{
+  if (executor != NULL)
+    return executor;
+
+  pthread_once(&hashsig_default_once, hashsig_default_init);
+  return hashsig_default_available ? &hashsig_default_executor : NULL;
+}
+
+#else
+
+hashsig_pool_t *hashsig_pool_create (size_t threads)
+{
+  return NULL;
+}
+
+void hashsig_pool_destroy (hashsig_pool_t *pool)
+{
+}
+
+void hashsig_pool_executor (hashsig_pool_t *pool, hashsig_executor_t *executor)
+{
+}
+
+const hashsig_executor_t *hashsig_executor (const hashsig_executor_t *executor)
+{
+  return executor;
+}
+
+#endif
+
+const hashsig_executor_t *hashsig_pool_default (void)
+{
+  return hashsig_executor(NULL);
+}
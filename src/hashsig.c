@@ -33,24 +33,66 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "keccak.h"
+#include "backend.h"
 #include "util.h"
 #include "ldwm_defs.h"
 #include "lmfs_defs.h"
 #include "hashsig_defs.h"
 #include "hashsig.h"
+#include "trace.h"
+#include "executor.h"
 
 /* libhashsig API */
 
 hashsig_t *hashsig_create_context (const uint8_t *const priv, const size_t priv_len, const hashsig_pub_t *pub)
 {
-  hashsig_t *ctx = hashsig_calloc(1, sizeof(hashsig_t));
-  ctx->pub = hashsig_calloc(1, LDWM_N);
-  ctx->keccak_ctx = hashsig_calloc(1, sizeof(keccak_ctx_t));
-  ctx->priv_scratch = hashsig_calloc(LMFS_LEAVES, LDWM_SIG_LEN);
-  ctx->pub_scratch = hashsig_calloc(LMFS_LEAVES, LDWM_N);
+  return hashsig_create_context_type(HASHSIG_TYPE_KECCAK_T32_B8_M32_N32_W4, priv, priv_len, pub);
+}
+
+/* Only the parameters compiled in are supported, but with any available hash function. */
+static int hashsig_type_supported (const uint32_t type)
+{
+  return !(type > 0xff || (type & ~HASHSIG_FAMILY_MASK) != LMFS_TYPE_PARAMS || hashsig_backend(type) == NULL);
+}
+
+typedef char hashsig_type_params_check[(LMFS_TYPE_PARAMS == (HASHSIG_TYPE_KECCAK_T32_B8_M32_N32_W4 & ~HASHSIG_FAMILY_MASK)) ? 1 : -1];
+
+/* Scratch space for the leaves of one tree, private and public parts in a single block. */
+#define HASHSIG_SCRATCH_LEN (LMFS_LEAVES * (LDWM_SIG_LEN + LDWM_N))
+#define HASHSIG_CACHE_LINE 64
+
+static void hashsig_free_context (hashsig_t *ctx, const hashsig_allocator_t *allocator)
+{
+  hashsig_dealloc(allocator, ctx->pub, LDWM_N);
+  hashsig_dealloc(allocator, ctx->hash_ctx, ctx->backend->ctx_size);
+  hashsig_dealloc(allocator, ctx->priv_scratch, HASHSIG_SCRATCH_LEN); /* No need to zero; always overwritten by public key intermediate values. */
+  hashsig_dealloc(allocator, ctx, sizeof(hashsig_t));
+}
+
+/* Same as hashsig_create_context_alloc, with the public key given as a buffer of hashsig_public_key_length - 1 bytes, without type. If it has to be calculated, executor runs the tasks. */
+static hashsig_t *hashsig_create_context_data (const uint32_t type, const uint8_t *const priv, const size_t priv_len, const uint8_t *pub, const hashsig_allocator_t *allocator, const hashsig_executor_t *executor)
+{
+  const hashsig_backend_t *backend = hashsig_backend(type);
+  hashsig_t *ctx;
+
+  if (!hashsig_type_supported(type))
+    return NULL;
+
+  if ((ctx = hashsig_alloc(allocator, sizeof(hashsig_t), HASHSIG_CACHE_LINE)) == NULL)
+    return NULL;
+  ctx->allocator = (allocator != NULL) ? *allocator : *hashsig_current_allocator();
+  ctx->backend = backend;
+  ctx->pub = hashsig_alloc(allocator, LDWM_N, sizeof(uint64_t));
+  ctx->hash_ctx = hashsig_alloc(allocator, backend->ctx_size, HASHSIG_CACHE_LINE);
+  ctx->priv_scratch = hashsig_alloc(allocator, HASHSIG_SCRATCH_LEN, HASHSIG_CACHE_LINE);
+  if (ctx->pub == NULL || ctx->hash_ctx == NULL || ctx->priv_scratch == NULL)
+  {
+    hashsig_free_context(ctx, allocator);
+    return NULL;
+  }
+  ctx->pub_scratch = ctx->priv_scratch + LMFS_LEAVES * LDWM_SIG_LEN;
   ctx->priv_len = priv_len;
-  ctx->type = HASHSIG_TYPE_KECCAK_T32_B8_M32_N32_W4;
+  ctx->type = type;
 
   hashsig_assert_ctx(ctx);
   assert(sizeof(ctx->type) == LMFS_SIG_HEADER);
@@ -59,36 +101,135 @@ hashsig_t *hashsig_create_context (const uint8_t *const priv, const size_t priv_
   /* Keep around pointer to user's private key buffer. */
   ctx->priv = priv;
 
-  /* Initialize Keccak for good measure. */
-  hashsig_keccak_prepare_hash(ctx->keccak_ctx, LDWM_N, NULL, 0);
+  /* Initialize hash function for good measure. */
+  backend->prepare_hash(ctx->hash_ctx, LDWM_N, NULL, 0);
 
   /* Calculate or copy public key. */
   if (pub != NULL)
-  {
-    assert(hashsig_public_key_length(ctx) == pub->len && pub->type == ctx->type);
-    memcpy(ctx->pub, pub->data, hashsig_public_key_length(ctx));
-  }
+    memcpy(ctx->pub, pub, hashsig_public_key_length(ctx) - 1);
   else
-    hashsig_lmfs_public_key(ctx, ctx->pub);
+    hashsig_lmfs_public_key(ctx, ctx->pub, executor);
 
   return ctx;
 }
 
 hashsig_t *hashsig_create_context_type (const uint32_t type, const uint8_t *const priv, const size_t priv_len, const hashsig_pub_t *pub)
 {
-  if (type != HASHSIG_TYPE_KECCAK_T32_B8_M32_N32_W4)
-    return NULL;
-  return hashsig_create_context(priv, priv_len, pub);
+  return hashsig_create_context_alloc(type, priv, priv_len, pub, NULL);
+}
+
+hashsig_t *hashsig_create_context_alloc (const uint32_t type, const uint8_t *const priv, const size_t priv_len, const hashsig_pub_t *pub, const hashsig_allocator_t *allocator)
+{
+  if (pub != NULL)
+    assert(pub->len == LDWM_N + 1 && pub->type == type);
+
+  return hashsig_create_context_data(type, priv, priv_len, pub != NULL ? pub->data : NULL, allocator, NULL);
+}
+
+hashsig_t *hashsig_create_context_parallel (const uint32_t type, const uint8_t *const priv, const size_t priv_len, const hashsig_allocator_t *allocator, const hashsig_executor_t *executor)
+{
+  return hashsig_create_context_data(type, priv, priv_len, NULL, allocator, hashsig_executor(executor));
 }
 
 void hashsig_destroy_context (hashsig_t *ctx)
 {
+  hashsig_allocator_t allocator;
+
   hashsig_assert_ctx(ctx);
-  hashsig_free(ctx->pub);
-  hashsig_free(ctx->keccak_ctx);
-  hashsig_free(ctx->priv_scratch); /* No need to zero; always overwritten by public key intermediate values. */
-  hashsig_free(ctx->pub_scratch);
-  hashsig_free(ctx);
+  allocator = ctx->allocator;
+  hashsig_free_context(ctx, &allocator);
+}
+
+hashsig_t *hashsig_clone_context (const hashsig_t *ctx)
+{
+  hashsig_t *clone;
+
+  hashsig_assert_ctx((hashsig_t *)ctx);
+
+  clone = hashsig_create_context_data(ctx->type, ctx->priv, ctx->priv_len, ctx->pub, &ctx->allocator, NULL);
+  if (clone != NULL)
+    clone->key = ctx->key;
+
+  return clone;
+}
+
+/* Shared keys */
+
+hashsig_key_t *hashsig_create_key (const uint32_t type, const uint8_t *const priv, const size_t priv_len, const hashsig_pub_t *pub, const hashsig_allocator_t *allocator)
+{
+  hashsig_key_t *key;
+  hashsig_t *ctx;
+
+  /* The context calculating the public key becomes the first idle handle. */
+  if ((ctx = hashsig_create_context_alloc(type, priv, priv_len, pub, allocator)) == NULL)
+    return NULL;
+
+  if ((key = hashsig_alloc(&ctx->allocator, sizeof(hashsig_key_t), sizeof(void *))) == NULL || (key->pub = hashsig_alloc(&ctx->allocator, LDWM_N, sizeof(uint64_t))) == NULL)
+  {
+    hashsig_dealloc(&ctx->allocator, key, sizeof(hashsig_key_t));
+    hashsig_destroy_context(ctx);
+    return NULL;
+  }
+
+  key->priv = priv;
+  key->priv_len = priv_len;
+  key->allocator = ctx->allocator;
+  key->type = type;
+  memcpy(key->pub, ctx->pub, LDWM_N);
+
+  ctx->key = key;
+  key->pool[0] = ctx;
+
+  return key;
+}
+
+void hashsig_destroy_key (hashsig_key_t *key)
+{
+  hashsig_allocator_t allocator = key->allocator;
+  size_t i;
+
+  for (i = 0; i < HASHSIG_KEY_POOL; i++)
+    if (key->pool[i] != NULL)
+      hashsig_destroy_context(key->pool[i]);
+
+  hashsig_dealloc(&allocator, key->pub, LDWM_N);
+  hashsig_dealloc(&allocator, key, sizeof(hashsig_key_t));
+}
+
+/* The pool is an array of slots, each either empty or holding an idle handle. Handles are moved in and out with compare and swap, so no locks are needed and a slot refilled in between still holds an idle handle. */
+hashsig_t *hashsig_key_acquire (hashsig_key_t *key)
+{
+  hashsig_t *ctx;
+  size_t i;
+
+  for (i = 0; i < HASHSIG_KEY_POOL; i++)
+  {
+    ctx = key->pool[i];
+    if (ctx != NULL && __sync_bool_compare_and_swap(&key->pool[i], ctx, NULL))
+      return ctx;
+  }
+
+  ctx = hashsig_create_context_data(key->type, key->priv, key->priv_len, key->pub, &key->allocator, NULL);
+  if (ctx != NULL)
+    ctx->key = key;
+
+  return ctx;
+}
+
+void hashsig_key_release (hashsig_t *ctx)
+{
+  hashsig_key_t *key;
+  size_t i;
+
+  hashsig_assert_ctx(ctx);
+  assert(ctx->key != NULL);
+  key = ctx->key;
+
+  for (i = 0; i < HASHSIG_KEY_POOL; i++)
+    if (key->pool[i] == NULL && __sync_bool_compare_and_swap(&key->pool[i], NULL, ctx))
+      return;
+
+  hashsig_destroy_context(ctx);
 }
 
 hashsig_pub_t *hashsig_get_public_key (hashsig_t *ctx)
@@ -123,28 +264,177 @@ hashsig_sig_t *hashsig_sign (hashsig_t *ctx, const uint8_t *message, const size_
   sig->len = hashsig_signature_length(ctx);
   sig->data = (uint8_t *)buf + sizeof(hashsig_sig_t);
 
-  hashsig_lmfs_sign(ctx, sig->data, message, len);
+  hashsig_sign_into(ctx, message, len, sig->data, sig->len);
 
   return sig;
 }
 
+size_t hashsig_sign_into (hashsig_t *ctx, const uint8_t *message, const size_t len, uint8_t *out, const size_t out_len)
+{
+  hashsig_assert_ctx(ctx);
+
+  if (out_len < hashsig_signature_length(ctx))
+    return hashsig_signature_length(ctx);
+
+  HASHSIG_TRACE_BEGIN(sign, len);
+  hashsig_lmfs_sign(ctx, out, message, len, NULL, NULL);
+  HASHSIG_TRACE_END(sign, len);
+
+  return 0;
+}
+
+/* Only one segment is kept in memory. Each is final once its tree is calculated, since the root it signs is known from the tree below. */
+int hashsig_sign_sink (hashsig_t *ctx, const uint8_t *message, const size_t len, int (*sink) (void *user, const uint8_t *data, const size_t len), void *user)
+{
+  uint8_t header[LMFS_SIG_HEADER];
+  uint8_t hash[LMFS_HASH_BYTES];
+  uint8_t last[LDWM_N];
+  uint8_t segment[LMFS_SEG_LEN];
+  int i, stopped = 0;
+
+  hashsig_assert_ctx(ctx);
+  HASHSIG_TRACE_BEGIN(sign, len);
+
+  hashsig_lmfs_message(ctx, header, hash, message, len);
+  memcpy(last, hash, LDWM_N);
+  stopped = sink(user, header, LMFS_SIG_HEADER);
+
+  for (i = LMFS_TREES - 1; i >= 0 && !stopped; i--)
+  {
+    hashsig_lmfs_sign_tree(ctx, segment, hash, last, i);
+    stopped = sink(user, segment, LMFS_SEG_LEN);
+  }
+
+  HASHSIG_TRACE_END(sign, len);
+  return stopped ? 1 : 0;
+}
+
+size_t hashsig_sign_parallel (hashsig_t *ctx, const uint8_t *message, const size_t len, uint8_t *out, const size_t out_len, const hashsig_executor_t *executor)
+{
+  hashsig_assert_ctx(ctx);
+
+  if (out_len < hashsig_signature_length(ctx))
+    return hashsig_signature_length(ctx);
+
+  HASHSIG_TRACE_BEGIN(sign, len);
+  hashsig_lmfs_sign_parallel(ctx, out, message, len, hashsig_executor(executor));
+  HASHSIG_TRACE_END(sign, len);
+
+  return 0;
+}
+
+size_t hashsig_sign_batch (hashsig_t *ctx, const uint8_t *const *messages, const size_t *lens, const size_t count, uint8_t *const *out, const size_t out_len, const hashsig_executor_t *executor)
+{
+  hashsig_assert_ctx(ctx);
+
+  if (out_len < hashsig_signature_length(ctx))
+    return hashsig_signature_length(ctx);
+
+  HASHSIG_TRACE_BEGIN(sign, count);
+  hashsig_lmfs_sign_batch(ctx, out, messages, lens, count, hashsig_executor(executor));
+  HASHSIG_TRACE_END(sign, count);
+
+  return 0;
+}
+
 int hashsig_verify (const hashsig_pub_t *pub, const hashsig_sig_t *sig, const uint8_t *message, const size_t len)
 {
-  uint8_t priv[64] = { 0 };
-  hashsig_t *ctx;
-  int valid;
+  const hashsig_pub_view_t pub_view = { pub->type, pub->len, pub->data };
+  const hashsig_sig_view_t sig_view = { sig->type, sig->len, sig->data };
+
+  return hashsig_verify_view(&pub_view, &sig_view, message, len);
+}
+
+int hashsig_verify_view (const hashsig_pub_view_t *pub, const hashsig_sig_view_t *sig, const uint8_t *message, const size_t len)
+{
+  return hashsig_verify_view_alloc(pub, sig, message, len, NULL);
+}
 
-  ctx = hashsig_create_context_type(pub->type, priv, sizeof(priv), pub);
+int hashsig_verify_view_alloc (const hashsig_pub_view_t *pub, const hashsig_sig_view_t *sig, const uint8_t *message, const size_t len, const hashsig_allocator_t *allocator)
+{
+  const hashsig_backend_t *backend = hashsig_backend(pub->type);
+  hashsig_t ctx;
+  int valid;
+  HASHSIG_TRACE_BEGIN(verify, len);
 
-  if (!(ctx != NULL && pub->type == sig->type && pub->len == hashsig_public_key_length(ctx) && sig->len == hashsig_signature_length(ctx)))
+  /* Verification only hashes, so unlike for signing, the context needs no scratch buffers, just the hash function state. */
+  memset(&ctx, 0, sizeof(ctx));
+  if (backend == NULL || pub->type > 0xff || (pub->type & ~HASHSIG_FAMILY_MASK) != LMFS_TYPE_PARAMS || pub->type != sig->type || pub->len != LDWM_N + 1 || sig->len != LMFS_SIG_LEN || (ctx.hash_ctx = hashsig_alloc(allocator, backend->ctx_size, 64)) == NULL)
   {
-    hashsig_free(ctx);
+    HASHSIG_TRACE_END(verify, len);
     return -1;
   }
+  ctx.backend = backend;
+  ctx.type = pub->type;
 
-  valid = hashsig_lmfs_verify(ctx, pub->data, sig->data, message, len);
-  hashsig_destroy_context(ctx);
+  valid = hashsig_lmfs_verify(&ctx, pub->data, sig->data, message, len);
+  hashsig_dealloc(allocator, ctx.hash_ctx, backend->ctx_size);
 
+  HASHSIG_TRACE_END(verify, len);
+  return valid;
+}
+
+/* Each batch verification task takes the next signature to verify until all are done. */
+typedef struct
+{
+  const hashsig_pub_view_t *pubs;
+  const hashsig_sig_view_t *sigs;
+  const uint8_t *const *messages;
+  const size_t *lens;
+  size_t count;
+  size_t *next;
+  int *results;
+  int valid;
+} hashsig_verify_task_t;
+
+static void hashsig_verify_task (void *arg)
+{
+  hashsig_verify_task_t *task = arg;
+  size_t i;
+  int valid;
+
+  while ((i = __sync_fetch_and_add(task->next, 1)) < task->count)
+  {
+    valid = hashsig_verify_view(&task->pubs[i], &task->sigs[i], task->messages[i], task->lens[i]);
+    if (task->results != NULL)
+      task->results[i] = valid;
+    if (valid < 0 || (valid > 0 && task->valid == 0))
+      task->valid = valid;
+  }
+}
+
+int hashsig_verify_batch (const hashsig_pub_view_t *pubs, const hashsig_sig_view_t *sigs, const uint8_t *const *messages, const size_t *lens, const size_t count, int *results, const hashsig_executor_t *executor)
+{
+  hashsig_verify_task_t *tasks;
+  size_t tasks_count, next = 0, i;
+  int valid = 0;
+
+  executor = hashsig_executor(executor);
+  tasks_count = hashsig_executor_concurrency(executor);
+  if (tasks_count > count)
+    tasks_count = count;
+  if (tasks_count == 0)
+    return 0;
+
+  tasks = hashsig_calloc(tasks_count, sizeof(hashsig_verify_task_t));
+  for (i = 0; i < tasks_count; i++)
+  {
+    tasks[i].pubs = pubs;
+    tasks[i].sigs = sigs;
+    tasks[i].messages = messages;
+    tasks[i].lens = lens;
+    tasks[i].count = count;
+    tasks[i].next = &next;
+    tasks[i].results = results;
+  }
+
+  hashsig_run_tasks(executor, hashsig_verify_task, tasks, sizeof(hashsig_verify_task_t), tasks_count);
+
+  for (i = 0; i < tasks_count; i++)
+    if (tasks[i].valid < 0 || (tasks[i].valid > 0 && valid == 0))
+      valid = tasks[i].valid;
+
+  hashsig_free(tasks);
   return valid;
 }
 
@@ -159,6 +449,34 @@ size_t hashsig_pub2buf (const hashsig_pub_t *pub, uint8_t *buf, const size_t len
   return 0;
 }
 
+int hashsig_pub_view (hashsig_pub_view_t *view, const uint8_t *buf, const size_t len)
+{
+  if (len < 1 || !hashsig_type_supported(buf[0]))
+    return -1;
+  if (len != LDWM_N + 1)
+    return 1;
+
+  view->type = buf[0];
+  view->len = len;
+  view->data = buf + 1;
+
+  return 0;
+}
+
+int hashsig_sig_view (hashsig_sig_view_t *view, const uint8_t *buf, const size_t len)
+{
+  if (len < 1 || !hashsig_type_supported(buf[0]))
+    return -1;
+  if (len != LMFS_SIG_LEN)
+    return 1;
+
+  view->type = buf[0];
+  view->len = len;
+  view->data = buf;
+
+  return 0;
+}
+
 size_t hashsig_buf2pub (hashsig_pub_t **pub_ptr, const uint8_t *buf, const size_t len)
 {
   char *alloc_buf;
@@ -243,10 +561,28 @@ int hashsig_object_type (const char *obj_type, const uint8_t type, char *str, co
   int m_or_t =      (type & 0x04);
   int n      =      (type & 0x08) ? 64 : 32;
   int b      =      (type & 0x10) ? 8 : 16;
-  char *algo =      (type & 0x20) ? "Skein" : "Keccak";
+  char *algo;
   int m, t;
   int ret;
 
+  switch (type & HASHSIG_FAMILY_MASK)
+  {
+    case HASHSIG_FAMILY_KECCAK:
+      algo = "Keccak";
+      break;
+    case HASHSIG_FAMILY_SKEIN:
+      algo = "Skein";
+      break;
+    case HASHSIG_FAMILY_SHA256:
+      algo = "SHA-256";
+      break;
+    case HASHSIG_FAMILY_TURBOSHAKE:
+      algo = "TurboSHAKE";
+      break;
+    default:
+      return 1;
+  }
+
   if (n == 32)
   {
     t = 32;
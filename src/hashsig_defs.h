@@ -30,15 +30,37 @@
 #ifndef HASHSIG_DEFS_H
 #define HASHSIG_DEFS_H
 
+#include "backend.h"
+#include "hashsig.h"
+
 struct hashsig_s
 {
   const uint8_t *priv;
   size_t priv_len;
   uint8_t *pub;
-  void *keccak_ctx;
+  const hashsig_backend_t *backend;
+  void *hash_ctx;
   uint8_t *priv_scratch;
   uint8_t *pub_scratch;
   uint8_t type;
+  hashsig_allocator_t allocator;
+  hashsig_key_t *key;
+#ifdef HASHSIG_STATS
+  hashsig_stats_t stats;
+#endif
+};
+
+/* Number of idle handles kept by a key. */
+#define HASHSIG_KEY_POOL 64
+
+struct hashsig_key_s
+{
+  const uint8_t *priv;
+  size_t priv_len;
+  uint8_t *pub;
+  hashsig_allocator_t allocator;
+  uint8_t type;
+  hashsig_t *volatile pool[HASHSIG_KEY_POOL];
 };
 
 struct hashsig_pub_s
@@ -28,6 +28,7 @@ void hashsig_KeccakF1600_StateOverwriteBytes(void *state, const unsigned char *d
 void hashsig_KeccakF1600_StateOverwriteWithZeroes(void *state, unsigned int byteCount);
 void hashsig_KeccakF1600_StateComplementBit(void *state, unsigned int position);
 void hashsig_KeccakF1600_StatePermute(void *state);
+void hashsig_KeccakP1600_12rounds_StatePermute(void *state);
 void hashsig_KeccakF1600_StateExtractBytes(const void *state, unsigned char *data, unsigned int offset, unsigned int length);
 void hashsig_KeccakF1600_StateExtractAndXORBytes(const void *state, unsigned char *data, unsigned int offset, unsigned int length);
 
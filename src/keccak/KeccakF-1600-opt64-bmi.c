@@ -0,0 +1,213 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Keccak-f[1600] and Keccak-p[1600, 12] for x86-64 CPUs with BMI1 and BMI2.
+ *
+ * This is the permutation of KeccakF-1600-opt64.c, built with -mbmi -mbmi2 so
+ * that chi maps to andn and the rotations to rorx. With andn, lane
+ * complementing does not save any instructions, so it is not used here. If
+ * the generic code keeps the state with complemented lanes, the state is
+ * converted on entry and exit of each function. The functions are selected at
+ * runtime by KeccakF-1600-opt64.c. */
+
+#include <string.h>
+#include <stdlib.h>
+#include "brg_endian.h"
+#include "KeccakF-1600-opt64-settings.h"
+#include "KeccakF-1600-interface.h"
+#include "KeccakF-1600-opt64-bmi.h"
+
+typedef unsigned char UINT8;
+typedef unsigned long long int UINT64;
+
+#if defined(__GNUC__)
+#define ALIGN __attribute__ ((aligned(32)))
+#else
+#define ALIGN
+#endif
+
+#if defined(UseLaneComplementing)
+#define StateComplemented
+#undef UseLaneComplementing
+#endif
+
+/* The compiler emits rorx by itself. */
+#define ROL64(a, offset) ((((UINT64)a) << offset) ^ (((UINT64)a) >> (64-offset)))
+
+#include "KeccakF-1600-64.macros"
+#include "KeccakF-1600-unrolling.macros"
+
+/* Convert between the state representation of KeccakF-1600-opt64.c and plain lanes. */
+#ifdef StateComplemented
+#define complementLanes(state) \
+    state[ 1] = ~state[ 1]; \
+    state[ 2] = ~state[ 2]; \
+    state[ 8] = ~state[ 8]; \
+    state[12] = ~state[12]; \
+    state[17] = ~state[17]; \
+    state[20] = ~state[20];
+#else
+#define complementLanes(state)
+#endif
+
+/* ---------------------------------------------------------------- */
+
+void hashsig_KeccakF1600_StatePermute_bmi(void *state)
+{
+    declareABCDE
+    #if (Unrolling != 24)
+    unsigned int i;
+    #endif
+    UINT64 *stateAsLanes = (UINT64*)state;
+
+    complementLanes(stateAsLanes)
+    copyFromState(A, stateAsLanes)
+    rounds
+    copyToState(stateAsLanes, A)
+    complementLanes(stateAsLanes)
+}
+
+/* ---------------------------------------------------------------- */
+
+size_t hashsig_KeccakF1600_FBWL_Absorb_bmi(void *state, unsigned int laneCount, const unsigned char *data, const size_t dataByteLen, unsigned char trailingBits)
+{
+    size_t originalDataByteLen = dataByteLen;
+    declareABCDE
+    #if (Unrolling != 24)
+    unsigned int i;
+    #endif
+    UINT64 *stateAsLanes = (UINT64*)state;
+    UINT64 *inDataAsLanes = (UINT64*)data;
+    size_t len = dataByteLen;
+
+    complementLanes(stateAsLanes)
+    copyFromState(A, stateAsLanes)
+    while(len >= laneCount*8) {
+        XORinputAndTrailingBits(A, inDataAsLanes, laneCount, ((UINT64)trailingBits))
+        rounds
+        inDataAsLanes += laneCount;
+        len -= laneCount*8;
+    }
+    copyToState(stateAsLanes, A)
+    complementLanes(stateAsLanes)
+    return originalDataByteLen - len;
+}
+
+/* ---------------------------------------------------------------- */
+
+size_t hashsig_KeccakF1600_FBWL_Squeeze_bmi(void *state, unsigned int laneCount, unsigned char *data, size_t dataByteLen)
+{
+    size_t originalDataByteLen = dataByteLen;
+    declareABCDE
+    #if (Unrolling != 24)
+    unsigned int i;
+    #endif
+    UINT64 *stateAsLanes = (UINT64*)state;
+    UINT64 *outDataAsLanes = (UINT64*)data;
+
+    complementLanes(stateAsLanes)
+    copyFromState(A, stateAsLanes)
+    while(dataByteLen >= laneCount*8) {
+        rounds
+        output(A, outDataAsLanes, laneCount)
+        outDataAsLanes += laneCount;
+        dataByteLen -= laneCount*8;
+    }
+    copyToState(stateAsLanes, A)
+    complementLanes(stateAsLanes)
+    return originalDataByteLen - dataByteLen;
+}
+
+/* ---------------------------------------------------------------- */
+
+void hashsig_KeccakP1600_12rounds_StatePermute_bmi(void *state)
+{
+    declareABCDE
+    #if (Unrolling != 24) && (Unrolling != 8)
+    unsigned int i;
+    #endif
+    UINT64 *stateAsLanes = (UINT64*)state;
+
+    complementLanes(stateAsLanes)
+    copyFromState(A, stateAsLanes)
+    rounds12
+    copyToState(stateAsLanes, A)
+    complementLanes(stateAsLanes)
+}
+
+/* ---------------------------------------------------------------- */
+
+size_t hashsig_KeccakP1600_12rounds_FBWL_Absorb_bmi(void *state, unsigned int laneCount, const unsigned char *data, const size_t dataByteLen, unsigned char trailingBits)
+{
+    size_t originalDataByteLen = dataByteLen;
+    declareABCDE
+    #if (Unrolling != 24) && (Unrolling != 8)
+    unsigned int i;
+    #endif
+    UINT64 *stateAsLanes = (UINT64*)state;
+    UINT64 *inDataAsLanes = (UINT64*)data;
+    size_t len = dataByteLen;
+
+    complementLanes(stateAsLanes)
+    copyFromState(A, stateAsLanes)
+    while(len >= laneCount*8) {
+        XORinputAndTrailingBits(A, inDataAsLanes, laneCount, ((UINT64)trailingBits))
+        rounds12
+        inDataAsLanes += laneCount;
+        len -= laneCount*8;
+    }
+    copyToState(stateAsLanes, A)
+    complementLanes(stateAsLanes)
+    return originalDataByteLen - len;
+}
+
+/* ---------------------------------------------------------------- */
+
+size_t hashsig_KeccakP1600_12rounds_FBWL_Squeeze_bmi(void *state, unsigned int laneCount, unsigned char *data, size_t dataByteLen)
+{
+    size_t originalDataByteLen = dataByteLen;
+    declareABCDE
+    #if (Unrolling != 24) && (Unrolling != 8)
+    unsigned int i;
+    #endif
+    UINT64 *stateAsLanes = (UINT64*)state;
+    UINT64 *outDataAsLanes = (UINT64*)data;
+
+    complementLanes(stateAsLanes)
+    copyFromState(A, stateAsLanes)
+    while(dataByteLen >= laneCount*8) {
+        rounds12
+        output(A, outDataAsLanes, laneCount)
+        outDataAsLanes += laneCount;
+        dataByteLen -= laneCount*8;
+    }
+    copyToState(stateAsLanes, A)
+    complementLanes(stateAsLanes)
+    return originalDataByteLen - dataByteLen;
+}
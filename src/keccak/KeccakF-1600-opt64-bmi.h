@@ -0,0 +1,43 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef KECCAKF1600OPT64BMI_H
+#define KECCAKF1600OPT64BMI_H
+
+#include <stddef.h>
+
+/* Keccak-f[1600] and Keccak-p[1600, 12] using BMI1 and BMI2 instructions. Only call these if hashsig_cpu_supports(HASHSIG_CPU_BMI1 | HASHSIG_CPU_BMI2). */
+void hashsig_KeccakF1600_StatePermute_bmi(void *state);
+size_t hashsig_KeccakF1600_FBWL_Absorb_bmi(void *state, unsigned int laneCount, const unsigned char *data, const size_t dataByteLen, unsigned char trailingBits);
+size_t hashsig_KeccakF1600_FBWL_Squeeze_bmi(void *state, unsigned int laneCount, unsigned char *data, size_t dataByteLen);
+void hashsig_KeccakP1600_12rounds_StatePermute_bmi(void *state);
+size_t hashsig_KeccakP1600_12rounds_FBWL_Absorb_bmi(void *state, unsigned int laneCount, const unsigned char *data, const size_t dataByteLen, unsigned char trailingBits);
+size_t hashsig_KeccakP1600_12rounds_FBWL_Squeeze_bmi(void *state, unsigned int laneCount, unsigned char *data, size_t dataByteLen);
+
+#endif /* KECCAKF1600OPT64BMI_H */
@@ -1,3 +1,8 @@
+#if defined(HASHSIG_KECCAK_TUNED)
+#include "KeccakF-1600-opt64-tuned.h" // Generated by the HASHSIG_KECCAK_AUTOTUNE build option
+#elif !defined(Unrolling)
 #define Unrolling 24
 #define UseLaneComplementing
 // #define UseSHLD // Can speed up on some platforms
+// #define UseRORX // Can speed up on some platforms, needs BMI2
+#endif
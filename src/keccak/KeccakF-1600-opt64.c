@@ -18,6 +18,18 @@ http://creativecommons.org/publicdomain/zero/1.0/
 #include "brg_endian.h"
 #include "KeccakF-1600-opt64-settings.h"
 #include "KeccakF-1600-interface.h"
+#ifdef HASHSIG_KECCAK_BMI
+#include "KeccakF-1600-opt64-bmi.h"
+#include "util.h"
+
+static int useBMI = 0;
+
+/* Runs when the library is loaded, so sponges initialized on several threads only read useBMI. */
+__attribute__ ((constructor)) static void hashsig_KeccakF1600_DetectBMI(void)
+{
+    useBMI = hashsig_cpu_supports(HASHSIG_CPU_BMI1 | HASHSIG_CPU_BMI2);
+}
+#endif
 
 typedef unsigned char UINT8;
 typedef unsigned long long int UINT64;
@@ -37,12 +49,19 @@ typedef unsigned long long int UINT64;
 #if defined(_MSC_VER)
 #define ROL64(a, offset) _rotl64(a, offset)
 #elif defined(UseSHLD)
-    #define ROL64(x,N) ({ \
+    #define ROL64(x,N) __extension__ ({ \
     register UINT64 __out; \
     register UINT64 __in = x; \
     __asm__ ("shld %2,%0,%0" : "=r"(__out) : "0"(__in), "i"(N)); \
     __out; \
     })
+#elif defined(UseRORX)
+    #define ROL64(x,N) __extension__ ({ \
+    register UINT64 __out; \
+    register UINT64 __in = x; \
+    __asm__ ("rorx %2,%1,%0" : "=r"(__out) : "r"(__in), "i"(64-(N))); \
+    __out; \
+    })
 #else
 #define ROL64(a, offset) ((((UINT64)a) << offset) ^ (((UINT64)a) >> (64-offset)))
 #endif
@@ -237,6 +256,12 @@ void hashsig_KeccakF1600_StateComplementBit(void *state, unsigned int position)
 
 void hashsig_KeccakF1600_StatePermute(void *state)
 {
+#ifdef HASHSIG_KECCAK_BMI
+    if (useBMI) {
+        hashsig_KeccakF1600_StatePermute_bmi(state);
+        return;
+    }
+#endif
     hashsig_KeccakF1600_StateXORPermuteExtract(state, 0, 0, 0, 0);
 }
 
@@ -442,6 +467,11 @@ void hashsig_KeccakF1600_StateXORPermuteExtract(void *state, const unsigned char
 
 size_t hashsig_KeccakF1600_FBWL_Absorb(void *state, unsigned int laneCount, const unsigned char *data, const size_t dataByteLen, unsigned char trailingBits)
 {
+#ifdef HASHSIG_KECCAK_BMI
+    if (useBMI) {
+        return hashsig_KeccakF1600_FBWL_Absorb_bmi(state, laneCount, data, dataByteLen, trailingBits);
+    }
+#endif
     size_t originalDataByteLen = dataByteLen;
     declareABCDE
     #if (Unrolling != 24)
@@ -466,6 +496,11 @@ size_t hashsig_KeccakF1600_FBWL_Absorb(void *state, unsigned int laneCount, cons
 
 size_t hashsig_KeccakF1600_FBWL_Squeeze(void *state, unsigned int laneCount, unsigned char *data, size_t dataByteLen)
 {
+#ifdef HASHSIG_KECCAK_BMI
+    if (useBMI) {
+        return hashsig_KeccakF1600_FBWL_Squeeze_bmi(state, laneCount, data, dataByteLen);
+    }
+#endif
     size_t originalDataByteLen = dataByteLen;
     declareABCDE
     #if (Unrolling != 24)
@@ -534,3 +569,83 @@ size_t hashsig_KeccakF1600_FBWL_Unwrap(void *state, unsigned int laneCount, cons
     copyToState(stateAsLanes, A)
     return originalDataByteLen - dataByteLen;
 }
+
+/* ---------------------------------------------------------------- */
+
+/* Keccak-p[1600, 12] for TurboSHAKE. */
+
+void hashsig_KeccakP1600_12rounds_StatePermute(void *state)
+{
+#ifdef HASHSIG_KECCAK_BMI
+    if (useBMI) {
+        hashsig_KeccakP1600_12rounds_StatePermute_bmi(state);
+        return;
+    }
+#endif
+    declareABCDE
+    #if (Unrolling != 24) && (Unrolling != 8)
+    unsigned int i;
+    #endif
+    UINT64 *stateAsLanes = (UINT64*)state;
+
+    copyFromState(A, stateAsLanes)
+    rounds12
+    copyToState(stateAsLanes, A)
+}
+
+/* ---------------------------------------------------------------- */
+
+size_t hashsig_KeccakP1600_12rounds_FBWL_Absorb(void *state, unsigned int laneCount, const unsigned char *data, const size_t dataByteLen, unsigned char trailingBits)
+{
+#ifdef HASHSIG_KECCAK_BMI
+    if (useBMI) {
+        return hashsig_KeccakP1600_12rounds_FBWL_Absorb_bmi(state, laneCount, data, dataByteLen, trailingBits);
+    }
+#endif
+    size_t originalDataByteLen = dataByteLen;
+    declareABCDE
+    #if (Unrolling != 24) && (Unrolling != 8)
+    unsigned int i;
+    #endif
+    UINT64 *stateAsLanes = (UINT64*)state;
+    UINT64 *inDataAsLanes = (UINT64*)data;
+    size_t len = dataByteLen;
+
+    copyFromState(A, stateAsLanes)
+    while(len >= laneCount*8) {
+        XORinputAndTrailingBits(A, inDataAsLanes, laneCount, ((UINT64)trailingBits))
+        rounds12
+        inDataAsLanes += laneCount;
+        len -= laneCount*8;
+    }
+    copyToState(stateAsLanes, A)
+    return originalDataByteLen - len;
+}
+
+/* ---------------------------------------------------------------- */
+
+size_t hashsig_KeccakP1600_12rounds_FBWL_Squeeze(void *state, unsigned int laneCount, unsigned char *data, size_t dataByteLen)
+{
+#ifdef HASHSIG_KECCAK_BMI
+    if (useBMI) {
+        return hashsig_KeccakP1600_12rounds_FBWL_Squeeze_bmi(state, laneCount, data, dataByteLen);
+    }
+#endif
+    size_t originalDataByteLen = dataByteLen;
+    declareABCDE
+    #if (Unrolling != 24) && (Unrolling != 8)
+    unsigned int i;
+    #endif
+    UINT64 *stateAsLanes = (UINT64*)state;
+    UINT64 *outDataAsLanes = (UINT64*)data;
+
+    copyFromState(A, stateAsLanes)
+    while(dataByteLen >= laneCount*8) {
+        rounds12
+        output(A, outDataAsLanes, laneCount)
+        outDataAsLanes += laneCount;
+        dataByteLen -= laneCount*8;
+    }
+    copyToState(stateAsLanes, A)
+    return originalDataByteLen - dataByteLen;
+}
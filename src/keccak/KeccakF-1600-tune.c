@@ -0,0 +1,83 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Microbenchmark for the Keccak-f[1600] permutation variants. Built and run
+ * by the HASHSIG_KECCAK_AUTOTUNE build option, once for each combination of
+ * Unrolling, UseLaneComplementing, UseSHLD and UseRORX given on the command
+ * line. Prints the best time for a mix of hash chain steps and long message
+ * absorption in tenths of nanoseconds per permutation. */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "KeccakF-1600-opt64.c"
+
+#define TUNE_LANES  9  /* Rate of 576 bits, as used by libhashsig. */
+#define TUNE_BLOCKS 64
+#define TUNE_RUNS   5
+
+int main (int argc, char *argv[])
+{
+  ALIGN unsigned char state[KeccakF_stateSizeInBytes] = { 0 };
+  ALIGN unsigned char data[TUNE_LANES * 8 * TUNE_BLOCKS] = { 0 };
+  unsigned long permutations, best = 0;
+  clock_t start, elapsed;
+  double t;
+  int run, i;
+
+  for (run = 0; run < TUNE_RUNS; run++)
+  {
+    permutations = 0;
+    start = clock();
+    do
+    {
+      /* Single permutations, like hash chain steps. */
+      for (i = 0; i < TUNE_BLOCKS; i++)
+        hashsig_KeccakF1600_StatePermute(state);
+
+      /* Absorption of a long message. */
+      hashsig_KeccakF1600_FBWL_Absorb(state, TUNE_LANES, data, sizeof(data), 0);
+
+      permutations += 2 * TUNE_BLOCKS;
+      elapsed = clock() - start;
+    }
+    while (elapsed < CLOCKS_PER_SEC / 20);
+
+    t = (double)elapsed / CLOCKS_PER_SEC * 1e10 / permutations;
+    if (run == 0 || (unsigned long)t < best)
+      best = (unsigned long)t;
+  }
+
+  /* Keep the state alive. */
+  if (state[0] == 0 && state[1] == 0 && state[2] == 0 && state[3] == 0)
+    fprintf(stderr, "Unlikely state.\n");
+
+  printf("%lu\n", best);
+  return 0;
+}
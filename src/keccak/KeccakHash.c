@@ -19,12 +19,19 @@ http://creativecommons.org/publicdomain/zero/1.0/
 /* ---------------------------------------------------------------- */
 
 HashReturn hashsig_Keccak_HashInitialize(Keccak_HashInstance *instance, unsigned int rate, unsigned int capacity, unsigned int hashbitlen, unsigned char delimitedSuffix)
+{
+    return hashsig_Keccak_HashInitializeRounds(instance, rate, capacity, hashbitlen, delimitedSuffix, 24);
+}
+
+/* ---------------------------------------------------------------- */
+
+HashReturn hashsig_Keccak_HashInitializeRounds(Keccak_HashInstance *instance, unsigned int rate, unsigned int capacity, unsigned int hashbitlen, unsigned char delimitedSuffix, unsigned int rounds)
 {
     HashReturn result;
 
     if (delimitedSuffix == 0)
         return FAIL;
-    result = hashsig_Keccak_SpongeInitialize(&instance->sponge, rate, capacity);
+    result = hashsig_Keccak_SpongeInitializeRounds(&instance->sponge, rate, capacity, rounds);
     if (result != SUCCESS)
         return result;
     instance->fixedOutputLength = hashbitlen;
@@ -46,6 +46,18 @@ typedef struct {
   */
 HashReturn hashsig_Keccak_HashInitialize(Keccak_HashInstance *hashInstance, unsigned int rate, unsigned int capacity, unsigned int hashbitlen, unsigned char delimitedSuffix);
 
+/**
+  * Same as Keccak_HashInitialize(), but on Keccak-p[1600, n_r] with the
+  * given number of rounds.
+  * @param  rounds          The number of rounds n_r, either 24 or 12.
+  * @return SUCCESS if successful, FAIL otherwise.
+  */
+HashReturn hashsig_Keccak_HashInitializeRounds(Keccak_HashInstance *hashInstance, unsigned int rate, unsigned int capacity, unsigned int hashbitlen, unsigned char delimitedSuffix, unsigned int rounds);
+
+/** Macro to initialize a TurboSHAKE256 instance with domain separation byte D.
+  */
+#define Keccak_HashInitialize_TurboSHAKE256(hashInstance, D)  hashsig_Keccak_HashInitializeRounds(hashInstance, 1088,  512,   0, D, 12)
+
 /** Macro to initialize a SHAKE128 instance as specified in the FIPS 202 draft.
   */
 #define Keccak_HashInitialize_SHAKE128(hashInstance)        hashsig_Keccak_HashInitialize(hashInstance, 1344,  256,   0, 0x1F)
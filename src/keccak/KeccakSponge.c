@@ -16,14 +16,35 @@ http://creativecommons.org/publicdomain/zero/1.0/
 #include <string.h>
 #include "KeccakSponge.h"
 #include "SnP-interface.h"
+#include "stats.h"
 #ifdef KeccakReference
 #include "displayIntermediateValues.h"
 #endif
 
 /* ---------------------------------------------------------------- */
 
+static void hashsig_Keccak_SpongePermute(Keccak_SpongeInstance *instance)
+{
+    HASHSIG_STATS_PERMUTATIONS(1);
+    if (instance->rounds == 12)
+        SnP_Permute_12rounds(instance->state);
+    else
+        SnP_Permute(instance->state);
+}
+
+/* ---------------------------------------------------------------- */
+
 int hashsig_Keccak_SpongeInitialize(Keccak_SpongeInstance *instance, unsigned int rate, unsigned int capacity)
 {
+    return hashsig_Keccak_SpongeInitializeRounds(instance, rate, capacity, 24);
+}
+
+/* ---------------------------------------------------------------- */
+
+int hashsig_Keccak_SpongeInitializeRounds(Keccak_SpongeInstance *instance, unsigned int rate, unsigned int capacity, unsigned int rounds)
+{
+    if ((rounds != 24) && (rounds != 12))
+        return 1;
     if (rate+capacity != SnP_width)
         return 1;
     if ((rate <= 0) || (rate > SnP_width) || ((rate % 8) != 0))
@@ -33,6 +54,7 @@ int hashsig_Keccak_SpongeInitialize(Keccak_SpongeInstance *instance, unsigned in
     instance->rate = rate;
     instance->byteIOIndex = 0;
     instance->squeezing = 0;
+    instance->rounds = rounds;
 
     return 0;
 }
@@ -56,7 +78,11 @@ int hashsig_Keccak_SpongeAbsorb(Keccak_SpongeInstance *instance, const unsigned
             // processing full blocks first
             if ((rateInBytes % SnP_laneLengthInBytes) == 0) {
                 // fast lane: whole lane rate
-                j = SnP_FBWL_Absorb(instance->state, rateInBytes/SnP_laneLengthInBytes, curData, dataByteLen - i, 0);
+                if (instance->rounds == 12)
+                    j = SnP_FBWL_Absorb_12rounds(instance->state, rateInBytes/SnP_laneLengthInBytes, curData, dataByteLen - i, 0);
+                else
+                    j = SnP_FBWL_Absorb(instance->state, rateInBytes/SnP_laneLengthInBytes, curData, dataByteLen - i, 0);
+                HASHSIG_STATS_PERMUTATIONS(j/rateInBytes);
                 i += j;
                 curData += j;
             }
@@ -66,7 +92,7 @@ int hashsig_Keccak_SpongeAbsorb(Keccak_SpongeInstance *instance, const unsigned
                     displayBytes(1, "Block to be absorbed", curData, rateInBytes);
                     #endif
                     SnP_XORBytes(instance->state, curData, 0, rateInBytes);
-                    SnP_Permute(instance->state);
+                    hashsig_Keccak_SpongePermute(instance);
                     curData+=rateInBytes;
                 }
                 i = dataByteLen - j;
@@ -86,7 +112,7 @@ int hashsig_Keccak_SpongeAbsorb(Keccak_SpongeInstance *instance, const unsigned
             curData += partialBlock;
             instance->byteIOIndex += partialBlock;
             if (instance->byteIOIndex == rateInBytes) {
-                SnP_Permute(instance->state);
+                hashsig_Keccak_SpongePermute(instance);
                 instance->byteIOIndex = 0;
             }
         }
@@ -114,7 +140,7 @@ int hashsig_Keccak_SpongeAbsorbLastFewBits(Keccak_SpongeInstance *instance, unsi
     SnP_XORBytes(instance->state, delimitedData1, instance->byteIOIndex, 1);
     // If the first bit of padding is at position rate-1, we need a whole new block for the second bit of padding
     if ((delimitedData >= 0x80) && (instance->byteIOIndex == (rateInBytes-1)))
-        SnP_Permute(instance->state);
+        hashsig_Keccak_SpongePermute(instance);
     // Second bit of padding
     SnP_ComplementBit(instance->state, rateInBytes*8-1);
     #ifdef KeccakReference
@@ -125,7 +151,7 @@ int hashsig_Keccak_SpongeAbsorbLastFewBits(Keccak_SpongeInstance *instance, unsi
         displayBytes(1, "Second bit of padding", block, rateInBytes);
     }
     #endif
-    SnP_Permute(instance->state);
+    hashsig_Keccak_SpongePermute(instance);
     instance->byteIOIndex = 0;
     instance->squeezing = 1;
     #ifdef KeccakReference
@@ -153,13 +179,17 @@ int hashsig_Keccak_SpongeSqueeze(Keccak_SpongeInstance *instance, unsigned char
             // processing full blocks first
             if ((rateInBytes % SnP_laneLengthInBytes) == 0) {
                 // fast lane: whole lane rate
-                j = SnP_FBWL_Squeeze(instance->state, rateInBytes/SnP_laneLengthInBytes, curData, dataByteLen - i);
+                if (instance->rounds == 12)
+                    j = SnP_FBWL_Squeeze_12rounds(instance->state, rateInBytes/SnP_laneLengthInBytes, curData, dataByteLen - i);
+                else
+                    j = SnP_FBWL_Squeeze(instance->state, rateInBytes/SnP_laneLengthInBytes, curData, dataByteLen - i);
+                HASHSIG_STATS_PERMUTATIONS(j/rateInBytes);
                 i += j;
                 curData += j;
             }
             else {
                 for(j=dataByteLen-i; j>=rateInBytes; j-=rateInBytes) {
-                    SnP_Permute(instance->state);
+                    hashsig_Keccak_SpongePermute(instance);
                     SnP_ExtractBytes(instance->state, curData, 0, rateInBytes);
                     #ifdef KeccakReference
                     displayBytes(1, "Squeezed block", curData, rateInBytes);
@@ -172,7 +202,7 @@ int hashsig_Keccak_SpongeSqueeze(Keccak_SpongeInstance *instance, unsigned char
         else {
             // normal lane: using the message queue
             if (instance->byteIOIndex == rateInBytes) {
-                SnP_Permute(instance->state);
+                hashsig_Keccak_SpongePermute(instance);
                 instance->byteIOIndex = 0;
             }
             partialBlock = (unsigned int)(dataByteLen - i);
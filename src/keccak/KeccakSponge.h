@@ -48,6 +48,8 @@ ALIGN typedef struct Keccak_SpongeInstanceStruct {
     unsigned int byteIOIndex;
     /** If set to 0, in the absorbing phase; otherwise, in the squeezing phase. */
     int squeezing;
+    /** The number of rounds of the permutation, 24 or 12. */
+    unsigned int rounds;
 } Keccak_SpongeInstance;
 
 /**
@@ -62,6 +64,14 @@ ALIGN typedef struct Keccak_SpongeInstanceStruct {
   */
 int hashsig_Keccak_SpongeInitialize(Keccak_SpongeInstance *spongeInstance, unsigned int rate, unsigned int capacity);
 
+/**
+  * Same as Keccak_SpongeInitialize(), but for the sponge function on
+  * Keccak-p[1600, n_r] with the given number of rounds.
+  * @param  rounds      The number of rounds n_r, either 24 or 12.
+  * @return Zero if successful, 1 otherwise.
+  */
+int hashsig_Keccak_SpongeInitializeRounds(Keccak_SpongeInstance *spongeInstance, unsigned int rate, unsigned int capacity, unsigned int rounds);
+
 /**
   * Function to give input data bytes for the sponge function to absorb.
   * @param  spongeInstance  Pointer to the sponge instance initialized by Keccak_SpongeInitialize().
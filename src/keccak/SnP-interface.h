@@ -43,8 +43,14 @@ http://creativecommons.org/publicdomain/zero/1.0/
 #define SnP_FBWL_Wrap                       hashsig_KeccakF1600_FBWL_Wrap
 #define SnP_FBWL_Unwrap                     hashsig_KeccakF1600_FBWL_Unwrap
 
+#define SnP_Permute_12rounds                hashsig_KeccakP1600_12rounds_StatePermute
+#define SnP_FBWL_Absorb_12rounds            hashsig_KeccakP1600_12rounds_FBWL_Absorb
+#define SnP_FBWL_Squeeze_12rounds           hashsig_KeccakP1600_12rounds_FBWL_Squeeze
+
 size_t hashsig_KeccakF1600_FBWL_Absorb(void *state, unsigned int laneCount, const unsigned char *data, const size_t dataByteLen, unsigned char trailingBits);
 size_t hashsig_KeccakF1600_FBWL_Squeeze(void *state, unsigned int laneCount, unsigned char *data, size_t dataByteLen);
+size_t hashsig_KeccakP1600_12rounds_FBWL_Absorb(void *state, unsigned int laneCount, const unsigned char *data, const size_t dataByteLen, unsigned char trailingBits);
+size_t hashsig_KeccakP1600_12rounds_FBWL_Squeeze(void *state, unsigned int laneCount, unsigned char *data, size_t dataByteLen);
 void hashsig_KeccakF1600_StateXORLanes(void *state, const unsigned char *data, unsigned int laneCount);
 void hashsig_KeccakF1600_StateXORBytesInLane(void *state, unsigned int lanePosition, const unsigned char *data, unsigned int offset, unsigned int length);
 void hashsig_KeccakF1600_StateExtractLanes(const void *state, unsigned char *data, unsigned int laneCount);
@@ -0,0 +1,102 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashsig.h"
+#include "KeccakHash.h"
+
+
+/* Test program */
+
+void dump_hex (const uint8_t *buf, const size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    printf("%02x", buf[i]);
+  printf("\n");
+}
+
+/* Hash a message with TurboSHAKE256 and domain separation byte D in two parts and print the last len bytes of out_len bytes of output. */
+void dump_turboshake256 (const uint8_t *msg, const size_t len, const uint8_t D, const size_t out_len, const size_t print_len)
+{
+  Keccak_HashInstance ctx;
+  uint8_t *out = malloc(out_len);
+
+  Keccak_HashInitialize_TurboSHAKE256(&ctx, D);
+  hashsig_Keccak_HashUpdate(&ctx, msg, len / 3 * 8);
+  hashsig_Keccak_HashUpdate(&ctx, msg + len / 3, (len - len / 3) * 8);
+  hashsig_Keccak_HashFinal(&ctx, NULL);
+  hashsig_Keccak_HashSqueeze(&ctx, out, out_len * 8);
+  dump_hex(out + out_len - print_len, print_len);
+  free(out);
+}
+
+/* Pattern messages of RFC 9861: bytes 00 to fa, repeated. */
+uint8_t *ptn (const size_t len)
+{
+  uint8_t *msg = malloc(len);
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    msg[i] = (uint8_t)(i % 251);
+  return msg;
+}
+
+int main (int argc, char *argv[])
+{
+  static const uint8_t ff[7] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  uint8_t *msg;
+  size_t i, len;
+
+  /* RFC 9861 test vectors for TurboSHAKE256. Empty message, also at the end of a long output. */
+  dump_turboshake256(NULL, 0, 0x1f, 64, 64);
+  dump_turboshake256(NULL, 0, 0x1f, 10032, 32);
+
+  /* Pattern messages of 17^i bytes, crossing the rate of 136 bytes from i = 2. */
+  for (i = 0, len = 1; i < 6; i++, len *= 17)
+  {
+    msg = ptn(len);
+    dump_turboshake256(msg, len, 0x1f, 64, 64);
+    free(msg);
+  }
+
+  /* Other domain separation bytes. */
+  dump_turboshake256(ff, 3, 0x01, 64, 64);
+  dump_turboshake256(ff, 1, 0x06, 64, 64);
+  dump_turboshake256(ff, 3, 0x07, 64, 64);
+  dump_turboshake256(ff, 7, 0x0b, 64, 64);
+  dump_turboshake256(ff, 1, 0x30, 64, 64);
+  dump_turboshake256(ff, 3, 0x7f, 64, 64);
+
+  return 0;
+}
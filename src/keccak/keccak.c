@@ -44,12 +44,21 @@ void hashsig_keccak_hash (keccak_ctx_t *ctx, uint8_t *out, const uint8_t *in, co
 	hashsig_Keccak_HashFinal(&hi, out);
 }
 
-void hashsig_keccak_prepare_hash (keccak_ctx_t *ctx, const size_t len, const uint8_t *nonce, const size_t nonce_len)
+/* Keccak with 24 rounds and a capacity of 1024 bits, or TurboSHAKE256 with 12 rounds and a rate of 1088 bits. */
+static void hashsig_keccak_initialize (keccak_ctx_t *ctx, const unsigned int rounds, const size_t len)
+{
+	if (rounds == 12)
+		hashsig_Keccak_HashInitializeRounds(ctx, 1088,  512, len * 8, 0x1F, 12);
+	else
+		hashsig_Keccak_HashInitialize(ctx, 576,  1024, len * 8, 0x06);
+}
+
+static void hashsig_keccak_prepare_hash_rounds (keccak_ctx_t *ctx, const unsigned int rounds, const size_t len, const uint8_t *nonce, const size_t nonce_len)
 {
 	uint8_t s_len = nonce_len;
 
 	assert(ctx != NULL);
-	hashsig_Keccak_HashInitialize(ctx, 576,  1024, len * 8, 0x06);
+	hashsig_keccak_initialize(ctx, rounds, len);
 
 	/* Prefix with depth and position in tree to personalize. */
 	hashsig_Keccak_HashUpdate(ctx, &s_len, 1);
@@ -57,27 +66,54 @@ void hashsig_keccak_prepare_hash (keccak_ctx_t *ctx, const size_t len, const uin
 		hashsig_Keccak_HashUpdate(ctx, nonce, nonce_len * 8);
 }
 
-void hashsig_keccak_sighash (uint8_t *out, size_t len, const uint8_t *pub, size_t pub_len, const uint8_t *msg, size_t msg_len)
+static void hashsig_keccak_sighash_init_rounds (keccak_ctx_t *ctx, const unsigned int rounds, size_t len, const uint8_t *pub, size_t pub_len)
 {
 	uint8_t sig_pub_separator[8] = { 'H', 'A', 'S', 'H', 'S', 'I', 'G', 'S' };
-	keccak_ctx_t hi;
 
 	assert(pub != NULL);
-	assert(msg != NULL);
 
-	hashsig_Keccak_HashInitialize(&hi, 576,  1024, len * 8, 0x06);
+	hashsig_keccak_initialize(ctx, rounds, len);
 
 	/* Add the public key to the message for personalization purposes. */
-	hashsig_Keccak_HashUpdate(&hi, sig_pub_separator, sizeof(sig_pub_separator) * 8);
-	hashsig_Keccak_HashUpdate(&hi, (uint8_t *)&pub_len, sizeof(pub_len));
-	hashsig_Keccak_HashUpdate(&hi, pub, pub_len * 8);
-	hashsig_Keccak_HashUpdate(&hi, sig_pub_separator, sizeof(sig_pub_separator) * 8);
+	hashsig_Keccak_HashUpdate(ctx, sig_pub_separator, sizeof(sig_pub_separator) * 8);
+	hashsig_Keccak_HashUpdate(ctx, (uint8_t *)&pub_len, sizeof(pub_len));
+	hashsig_Keccak_HashUpdate(ctx, pub, pub_len * 8);
+	hashsig_Keccak_HashUpdate(ctx, sig_pub_separator, sizeof(sig_pub_separator) * 8);
+}
+
+static void hashsig_keccak_sighash_rounds (const unsigned int rounds, uint8_t *out, size_t len, const uint8_t *pub, size_t pub_len, const uint8_t *msg, size_t msg_len)
+{
+	keccak_ctx_t hi;
+
+	assert(msg != NULL);
 
+	hashsig_keccak_sighash_init_rounds(&hi, rounds, len, pub, pub_len);
 	hashsig_Keccak_HashUpdate(&hi, msg, msg_len * 8);
 	hashsig_Keccak_HashFinal(&hi, out);
 }
 
-void hashsig_keccak_stream (keccak_ctx_t *ctx, uint8_t *out, size_t len, const uint8_t *key, size_t key_len, const uint8_t *nonce, size_t nonce_len)
+/* Incremental form of the message hash, for messages arriving in parts. */
+void hashsig_keccak_sighash_init (keccak_ctx_t *ctx, size_t len, const uint8_t *pub, size_t pub_len)
+{
+	hashsig_keccak_sighash_init_rounds(ctx, 24, len, pub, pub_len);
+}
+
+void hashsig_turboshake_sighash_init (keccak_ctx_t *ctx, size_t len, const uint8_t *pub, size_t pub_len)
+{
+	hashsig_keccak_sighash_init_rounds(ctx, 12, len, pub, pub_len);
+}
+
+void hashsig_keccak_sighash_update (keccak_ctx_t *ctx, const uint8_t *msg, size_t msg_len)
+{
+	hashsig_Keccak_HashUpdate(ctx, msg, msg_len * 8);
+}
+
+void hashsig_keccak_sighash_final (keccak_ctx_t *ctx, uint8_t *out)
+{
+	hashsig_Keccak_HashFinal(ctx, out);
+}
+
+static void hashsig_keccak_stream_rounds (keccak_ctx_t *ctx, const unsigned int rounds, uint8_t *out, size_t len, const uint8_t *key, size_t key_len, const uint8_t *nonce, size_t nonce_len)
 {
 	uint8_t key_separator[8] = { 'H', 'A', 'S', 'H', 'S', 'I', 'G', 'K' };
 	uint8_t nonce_separator[8] = { 'H', 'A', 'S', 'H', 'S', 'I', 'G', 'N' };
@@ -86,7 +122,7 @@ void hashsig_keccak_stream (keccak_ctx_t *ctx, uint8_t *out, size_t len, const u
 	assert(key != NULL);
 	assert(nonce != NULL);
 
-	hashsig_Keccak_HashInitialize(ctx, 576,  1024, len * 8, 0x06);
+	hashsig_keccak_initialize(ctx, rounds, len);
 
 	/* Add secret key. */
 	hashsig_Keccak_HashUpdate(ctx, key_separator, sizeof(key_separator) * 8);
@@ -103,3 +139,35 @@ void hashsig_keccak_stream (keccak_ctx_t *ctx, uint8_t *out, size_t len, const u
 	/* Squeeze necessary amount of bits from the sponge. */
 	hashsig_Keccak_HashFinal(ctx, out);
 }
+
+void hashsig_keccak_prepare_hash (keccak_ctx_t *ctx, const size_t len, const uint8_t *nonce, const size_t nonce_len)
+{
+	hashsig_keccak_prepare_hash_rounds(ctx, 24, len, nonce, nonce_len);
+}
+
+void hashsig_keccak_sighash (uint8_t *out, size_t len, const uint8_t *pub, size_t pub_len, const uint8_t *msg, size_t msg_len)
+{
+	hashsig_keccak_sighash_rounds(24, out, len, pub, pub_len, msg, msg_len);
+}
+
+void hashsig_keccak_stream (keccak_ctx_t *ctx, uint8_t *out, size_t len, const uint8_t *key, size_t key_len, const uint8_t *nonce, size_t nonce_len)
+{
+	hashsig_keccak_stream_rounds(ctx, 24, out, len, key, key_len, nonce, nonce_len);
+}
+
+/* TurboSHAKE256 variants. The prepared context is used with hashsig_keccak_hash. */
+
+void hashsig_turboshake_prepare_hash (keccak_ctx_t *ctx, const size_t len, const uint8_t *nonce, const size_t nonce_len)
+{
+	hashsig_keccak_prepare_hash_rounds(ctx, 12, len, nonce, nonce_len);
+}
+
+void hashsig_turboshake_sighash (uint8_t *out, size_t len, const uint8_t *pub, size_t pub_len, const uint8_t *msg, size_t msg_len)
+{
+	hashsig_keccak_sighash_rounds(12, out, len, pub, pub_len, msg, msg_len);
+}
+
+void hashsig_turboshake_stream (keccak_ctx_t *ctx, uint8_t *out, size_t len, const uint8_t *key, size_t key_len, const uint8_t *nonce, size_t nonce_len)
+{
+	hashsig_keccak_stream_rounds(ctx, 12, out, len, key, key_len, nonce, nonce_len);
+}
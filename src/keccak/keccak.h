@@ -38,6 +38,15 @@ typedef Keccak_HashInstance keccak_ctx_t;
 void hashsig_keccak_hash(keccak_ctx_t *ctx, uint8_t *out, const uint8_t *in, const size_t len);
 void hashsig_keccak_prepare_hash (keccak_ctx_t *ctx, const size_t len, const uint8_t *nonce, const size_t nonce_len);
 void hashsig_keccak_sighash (uint8_t *out, size_t len, const uint8_t *pub, size_t pub_len, const uint8_t *msg, size_t msg_len);
+void hashsig_keccak_sighash_init (keccak_ctx_t *ctx, size_t len, const uint8_t *pub, size_t pub_len);
+void hashsig_keccak_sighash_update (keccak_ctx_t *ctx, const uint8_t *msg, size_t msg_len);
+void hashsig_keccak_sighash_final (keccak_ctx_t *ctx, uint8_t *out);
 void hashsig_keccak_stream (keccak_ctx_t *ctx, uint8_t *out, size_t len, const uint8_t *key, size_t key_len, const uint8_t *nonce, size_t nonce_len);
 
+/* Same, based on TurboSHAKE256. Use hashsig_keccak_hash with the prepared context. */
+void hashsig_turboshake_prepare_hash (keccak_ctx_t *ctx, const size_t len, const uint8_t *nonce, const size_t nonce_len);
+void hashsig_turboshake_sighash (uint8_t *out, size_t len, const uint8_t *pub, size_t pub_len, const uint8_t *msg, size_t msg_len);
+void hashsig_turboshake_sighash_init (keccak_ctx_t *ctx, size_t len, const uint8_t *pub, size_t pub_len);
+void hashsig_turboshake_stream (keccak_ctx_t *ctx, uint8_t *out, size_t len, const uint8_t *key, size_t key_len, const uint8_t *nonce, size_t nonce_len);
+
 #endif /* KECCAK_H */
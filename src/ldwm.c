@@ -32,8 +32,12 @@
 #include <string.h>
 
 #include "ldwm_defs.h"
-#include "keccak.h"
 #include "util.h"
+#include "stats.h"
+#include "trace.h"
+
+/* The checksum has to fit its two bytes after the hash, and w has to divide a byte. */
+typedef char hashsig_ldwm_params_check[(LDWM_LS >= 0 && LDWM_DIGITS_PER_BYTE * LDWM_W == 8) ? 1 : -1];
 
 void hashsig_ldwm_f (hashsig_t *ctx, const int n, uint8_t *buf)
 {
@@ -52,15 +56,92 @@ void hashsig_ldwm_f (hashsig_t *ctx, const int n, uint8_t *buf)
       LDWM_H(buf, buf, LDWM_M);
 }
 
+/* Apply F to each of the given chains of M bytes in buf, counts[i] times or n times if counts is NULL. With a multi-lane hash function, lanes are refilled with the next chain as soon as their chain is done. */
+void hashsig_ldwm_chains (hashsig_t *ctx, uint8_t *buf, const uint8_t *counts, const int n, const size_t chains)
+{
+  const size_t lanes = ctx->backend->lanes;
+  uint8_t tmp[HASHSIG_MAX_LANES][LDWM_N];
+  uint8_t *lane[HASHSIG_MAX_LANES];
+  size_t chain[HASHSIG_MAX_LANES];
+  int left[HASHSIG_MAX_LANES];
+  int busy[HASHSIG_MAX_LANES] = { 0 };
+  size_t i = 0, l, active;
+
+  if (lanes < 2)
+  {
+    for (i = 0; i < chains; i++)
+      hashsig_ldwm_f(ctx, counts != NULL ? counts[i] : n, buf + i * LDWM_M);
+    return;
+  }
+
+  /* Idle lanes hash their buffers for nothing. */
+  memset(tmp, 0, sizeof(tmp));
+  for (l = 0; l < lanes; l++)
+    lane[l] = tmp[l];
+
+  for (;;)
+  {
+    active = 0;
+    for (l = 0; l < lanes; l++)
+    {
+      /* Store finished chain. */
+      if (busy[l] && left[l] == 0)
+      {
+        memcpy(buf + chain[l] * LDWM_M, tmp[l], LDWM_M);
+        busy[l] = 0;
+      }
+
+      /* Refill lane with the next chain that needs any work. */
+      if (!busy[l])
+      {
+        while (i < chains && (counts != NULL ? counts[i] : n) == 0)
+          i++;
+        if (i < chains)
+        {
+          memcpy(tmp[l], buf + i * LDWM_M, LDWM_M);
+          left[l] = counts != NULL ? counts[i] : n;
+          chain[l] = i++;
+          busy[l] = 1;
+        }
+      }
+
+      active += busy[l];
+    }
+
+    if (active == 0)
+      break;
+
+    ctx->backend->hash_multi(ctx->hash_ctx, lane, (const uint8_t *const *)lane, LDWM_M);
+    for (l = 0; l < lanes; l++)
+      if (busy[l])
+        left[l]--;
+  }
+}
+
 void hashsig_ldwm_public_key (hashsig_t *ctx, uint8_t *priv, uint8_t *pub)
+{
+  hashsig_ldwm_public_keys(ctx, priv, pub, 1);
+}
+
+/* Calculate the public keys for several consecutive private keys at once, keeping all lanes of a multi-lane hash function busy. */
+void hashsig_ldwm_public_keys (hashsig_t *ctx, uint8_t *priv, uint8_t *pub, const size_t keys)
 {
   static const int e = LDWM_2_POW_W_MINUS_1;
   size_t i;
-
-  for (i = 0; i < LDWM_SIG_LEN; i += LDWM_M)
-    hashsig_ldwm_f(ctx, e, priv + i);
-
-  LDWM_H(pub, priv, LDWM_SIG_LEN);
+  HASHSIG_STATS_MARK
+
+  HASHSIG_TRACE_BEGIN(chains, keys);
+  HASHSIG_STATS_BEGIN();
+  hashsig_ldwm_chains(ctx, priv, NULL, e, keys * LDWM_P);
+  HASHSIG_STATS_END(ctx, HASHSIG_PHASE_CHAINS, (uint64_t)keys * LDWM_P * e);
+  HASHSIG_TRACE_END(chains, keys);
+
+  HASHSIG_TRACE_BEGIN(leaves, keys);
+  HASHSIG_STATS_BEGIN();
+  for (i = 0; i < keys; i++)
+    LDWM_H(pub + i * LDWM_N, priv + i * LDWM_SIG_LEN, LDWM_SIG_LEN);
+  HASHSIG_STATS_END(ctx, HASHSIG_PHASE_LEAVES, keys);
+  HASHSIG_TRACE_END(leaves, keys);
 }
 
 /* Simple explanation of the checksum:
@@ -76,25 +157,32 @@ uint16_t hashsig_ldwm_checksum (const uint8_t *hash)
   size_t i, j;
 
   for (i = 0; i < LDWM_N; i++)
+    for (j = 0; j < LDWM_DIGITS_PER_BYTE; j++)
+      sum += e - ((hash[i] >> (j * LDWM_W)) & e);
+
+  return (sum << LDWM_LS);
+}
+
+/* Split the hash and checksum in v into the digits of the LDWM_P chains, subtracted from the maximum if complement is set. Digit i is bits (i * w) % 8 and up of byte (i * w) / 8. */
+static void hashsig_ldwm_counts (const uint8_t *v, uint8_t *counts, const int complement)
+{
+  static const int e = LDWM_2_POW_W_MINUS_1;
+  size_t i;
+
+  for (i = 0; i < LDWM_P; i++)
   {
-    uint8_t a = hash[i];
+    const uint8_t digit = (v[i / LDWM_DIGITS_PER_BYTE] >> ((i % LDWM_DIGITS_PER_BYTE) * LDWM_W)) & e;
 
-    for (j = 0; j < 8; j += LDWM_W)
-    {
-      sum += e - (a & e);
-      a >>= LDWM_W;
-    }
+    counts[i] = complement ? e - digit : digit;
   }
-
-  return (sum << LDWM_LS);
 }
 
 void hashsig_ldwm_sign (hashsig_t *ctx, uint8_t *priv, const uint8_t *message, const size_t len, const int pre_hashed)
 {
-  static const int e = LDWM_2_POW_W_MINUS_1;
+  uint8_t counts[LDWM_P];
   uint8_t v[LDWM_N + 2];
   uint16_t c;
-  size_t i, j, m = 0;
+  HASHSIG_STATS_MARK
 
   if (pre_hashed)
     memcpy(v, message, LDWM_N);
@@ -103,28 +191,21 @@ void hashsig_ldwm_sign (hashsig_t *ctx, uint8_t *priv, const uint8_t *message, c
 
   c = hashsig_ldwm_checksum(v);
   hashsig_store_le16(v + LDWM_N, c);
+  hashsig_ldwm_counts(v, counts, 0);
 
-  for (i = 0; i < LDWM_P; )
-  {
-    uint8_t a = v[m++];
-
-    for (j = 0; j < 8 && i < LDWM_P; j += LDWM_W)
-    {
-      hashsig_ldwm_f(ctx, a & e, priv + i * LDWM_M);
-
-      a >>= LDWM_W;
-      i++;
-    }
-  }
+  HASHSIG_TRACE_BEGIN(ldwm_sign, LDWM_P);
+  HASHSIG_STATS_BEGIN();
+  hashsig_ldwm_chains(ctx, priv, counts, 0, LDWM_P);
+  HASHSIG_STATS_END(ctx, HASHSIG_PHASE_SIGN, hashsig_stats_sum(counts, LDWM_P));
+  HASHSIG_TRACE_END(ldwm_sign, LDWM_P);
 }
 
 int hashsig_ldwm_verify (hashsig_t *ctx, const uint8_t *pub, const uint8_t *sig, const uint8_t *message, const size_t len, const int pre_hashed)
 {
-  static const int e = LDWM_2_POW_W_MINUS_1;
   uint8_t copy[LDWM_SIG_LEN];
+  uint8_t counts[LDWM_P];
   uint8_t v[LDWM_N + 2];
   uint16_t c;
-  size_t i, j, m = 0;
 
   if (pre_hashed)
     memcpy(v, message, LDWM_N);
@@ -132,25 +213,15 @@ int hashsig_ldwm_verify (hashsig_t *ctx, const uint8_t *pub, const uint8_t *sig,
     LDWM_H(v, message, len);
 
   c = hashsig_ldwm_checksum(v);
-  v[LDWM_N] = c & 0xff;
-  v[LDWM_N + 1] = c >> 8;
+  hashsig_store_le16(v + LDWM_N, c);
+  hashsig_ldwm_counts(v, counts, 1);
 
   memcpy(copy, sig, LDWM_SIG_LEN);
 
-  for (i = 0; i < LDWM_P; )
-  {
-    uint8_t a = v[m++];
-
-    for (j = 0; j < 8 && i < LDWM_P; j += LDWM_W)
-    {
-      hashsig_ldwm_f(ctx, e - (a & e), copy + i * LDWM_M);
-
-      a >>= LDWM_W;
-      i++;
-    }
-  }
-
+  HASHSIG_TRACE_BEGIN(ldwm_verify, LDWM_P);
+  hashsig_ldwm_chains(ctx, copy, counts, 0, LDWM_P);
   LDWM_H(v, copy, LDWM_SIG_LEN);
+  HASHSIG_TRACE_END(ldwm_verify, LDWM_P);
 
   if (memcmp(pub, v, LDWM_N))
     return 1;
@@ -33,7 +33,6 @@
 #include <stdint.h>
 #include "hashsig_defs.h"
 #include "hashsig.h"
-#include "KeccakHash.h"
 
 /*
    Fixed up but sparse table:
@@ -49,7 +48,7 @@
    +--------------------+--------+-----------+----+----+---+-----+----+
 */
 
-#define LDWM_H(output, input, len) hashsig_keccak_hash(ctx->keccak_ctx, output, input, len)
+#define LDWM_H(output, input, len) ctx->backend->hash(ctx->hash_ctx, output, input, len)
 #define LDWM_M 32
 #define LDWM_N 32
 #define LDWM_W 4
@@ -61,12 +60,24 @@
      v = ceil((floor(lg((2^w - 1) * u)) + 1) / w)
      ls = (number of bits in sum) - (v * w)
      p = u + v
+
+   All of them are constant expressions, so loops over digits and chains have fixed trip counts and are unrolled for the chosen parameters.
 */
-#define LDWM_P 67
-#define LDWM_LS 4
+#define LDWM_BITS16(x) ((x) >> 15 ? 16 : (x) >> 14 ? 15 : (x) >> 13 ? 14 : (x) >> 12 ? 13 : (x) >> 11 ? 12 : (x) >> 10 ? 11 : (x) >> 9 ? 10 : (x) >> 8 ? 9 : (x) >> 7 ? 8 : (x) >> 6 ? 7 : (x) >> 5 ? 6 : (x) >> 4 ? 5 : (x) >> 3 ? 4 : (x) >> 2 ? 3 : (x) >> 1 ? 2 : 1)
+#define LDWM_DIGITS_PER_BYTE (8 / LDWM_W)
+#define LDWM_U ((8 * LDWM_N + LDWM_W - 1) / LDWM_W)
+#define LDWM_V ((LDWM_BITS16(LDWM_2_POW_W_MINUS_1 * LDWM_U) + LDWM_W - 1) / LDWM_W)
+#define LDWM_P (LDWM_U + LDWM_V)
+#define LDWM_LS (16 - LDWM_V * LDWM_W)
+
+/* Parameter bits of the type, below the hash function family. */
+#define LDWM_TYPE_W ((LDWM_W == 1) ? 0x00 : (LDWM_W == 2) ? 0x01 : (LDWM_W == 4) ? 0x02 : 0x03)
+#define LDWM_TYPE_MN ((LDWM_M == 20) ? 0x00 : (LDWM_M == 32) ? 0x04 : 0x08)
 
 void hashsig_ldwm_f (hashsig_t *ctx, const int n, uint8_t *buf);
+void hashsig_ldwm_chains (hashsig_t *ctx, uint8_t *buf, const uint8_t *counts, const int n, const size_t chains);
 void hashsig_ldwm_public_key (hashsig_t *ctx, uint8_t *priv, uint8_t *pub);
+void hashsig_ldwm_public_keys (hashsig_t *ctx, uint8_t *priv, uint8_t *pub, const size_t keys);
 uint16_t hashsig_ldwm_checksum (const uint8_t *hash);
 void hashsig_ldwm_sign (hashsig_t *ctx, uint8_t *priv, const uint8_t *message, const size_t len, const int pre_hashed);
 int hashsig_ldwm_verify (hashsig_t *ctx, const uint8_t *pub, const uint8_t *sig, const uint8_t *message, const size_t len, const int pre_hashed);
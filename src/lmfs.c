@@ -29,45 +29,128 @@
 
 /* Lazy Merkle Forest Signatures */
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "ldwm_defs.h"
 #include "lmfs_defs.h"
-#include "keccak.h"
 #include "util.h"
+#include "stats.h"
+#include "trace.h"
+#include "executor.h"
 
-void hashsig_lmfs_tree (hashsig_t *ctx, const uint8_t *hash, const uint8_t depth, uint8_t *root_pub, uint8_t *mt_path, uint8_t *priv, uint8_t *pub)
+/* Leaf-level task: public keys of a range of leaves, with a copy of the context owning its own hash state. */
+typedef struct
+{
+  hashsig_t ctx;
+  uint8_t *priv;
+  uint8_t *pub;
+  size_t keys;
+} hashsig_lmfs_leaves_task_t;
+
+static void hashsig_lmfs_leaves_task (void *arg)
+{
+  hashsig_lmfs_leaves_task_t *task = arg;
+
+  hashsig_ldwm_public_keys(&task->ctx, task->priv, task->pub, task->keys);
+}
+
+/* Calculate public keys of all leaves of a tree, split into tasks if executor is not NULL. */
+static void hashsig_lmfs_leaves (hashsig_t *ctx, uint8_t *priv_leaves, uint8_t *pub_leaves, const hashsig_executor_t *executor)
+{
+  const size_t ctx_size = ctx->backend->ctx_size;
+  hashsig_lmfs_leaves_task_t *tasks;
+  uint8_t *hash_ctx = NULL;
+  size_t count, chunk, i;
+
+  /* Keep chunks a multiple of the maximum number of lanes, so multi-lane hash functions stay busy. */
+  count = hashsig_executor_concurrency(executor);
+  chunk = (LMFS_LEAVES + count - 1) / count;
+  chunk = (chunk + HASHSIG_MAX_LANES - 1) / HASHSIG_MAX_LANES * HASHSIG_MAX_LANES;
+  count = (LMFS_LEAVES + chunk - 1) / chunk;
+
+  if (count > 1)
+    hash_ctx = hashsig_alloc(&ctx->allocator, count * ctx_size, 64);
+
+  if (hash_ctx == NULL)
+  {
+    hashsig_ldwm_public_keys(ctx, priv_leaves, pub_leaves, LMFS_LEAVES);
+    return;
+  }
+
+  tasks = hashsig_calloc(count, sizeof(hashsig_lmfs_leaves_task_t));
+  for (i = 0; i < count; i++)
+  {
+    tasks[i].ctx = *ctx;
+    tasks[i].ctx.hash_ctx = hash_ctx + i * ctx_size;
+    memcpy(tasks[i].ctx.hash_ctx, ctx->hash_ctx, ctx_size);
+    HASHSIG_STATS_RESET(&tasks[i].ctx);
+    tasks[i].priv = priv_leaves + i * chunk * LDWM_SIG_LEN;
+    tasks[i].pub = pub_leaves + i * chunk * LDWM_N;
+    tasks[i].keys = (i + 1 < count) ? chunk : LMFS_LEAVES - i * chunk;
+  }
+
+  hashsig_run_tasks(executor, hashsig_lmfs_leaves_task, tasks, sizeof(hashsig_lmfs_leaves_task_t), count);
+
+  for (i = 0; i < count; i++)
+    HASHSIG_STATS_ADD(ctx, &tasks[i].ctx);
+
+  hashsig_free(tasks);
+  hashsig_dealloc(&ctx->allocator, hash_ctx, count * ctx_size);
+}
+
+/* Select the target leaf of the tree at depth from the message hash. */
+static uint16_t hashsig_lmfs_leaf (const uint8_t *hash, const int depth)
+{
+  if (LMFS_TREE_HEIGHT == 16)
+    return hashsig_load_le16(hash + depth * 2);
+  else
+    return hash[depth];
+}
+
+/* Generate the private keys of all leaves of the tree at depth into priv_scratch. Secret state left in the context is overwritten by personalizing the hash function for the tree. */
+static void hashsig_lmfs_tree_keys (hashsig_t *ctx, const uint8_t *hash, const int depth)
+{
+  HASHSIG_STATS_MARK
+
+  HASHSIG_TRACE_BEGIN(prf, depth);
+  HASHSIG_STATS_BEGIN();
+  ctx->backend->stream(ctx->hash_ctx, ctx->priv_scratch, LMFS_LEAVES * LDWM_SIG_LEN, ctx->priv, ctx->priv_len, hash, depth * LMFS_DEPTH_BYTES);
+  HASHSIG_STATS_END(ctx, HASHSIG_PHASE_PRF, 1);
+  HASHSIG_TRACE_END(prf, depth);
+
+  ctx->backend->prepare_hash(ctx->hash_ctx, LDWM_N, hash, depth);
+}
+
+void hashsig_lmfs_tree (hashsig_t *ctx, const uint8_t *hash, const uint8_t depth, uint8_t *root_pub, uint8_t *mt_path, uint8_t *priv, uint8_t *pub, const hashsig_executor_t *executor)
 {
   uint8_t *priv_leaves = ctx->priv_scratch;
   uint8_t *pub_leaves = ctx->pub_scratch;
   uint16_t leaf;
   size_t i, j;
+  HASHSIG_STATS_MARK
 
-  /* Generate leaves and select target leaf from message hash. */
-  if (LMFS_TREE_HEIGHT == 16)
-    leaf = hashsig_load_le16(hash + depth * 2);
-  else
-    leaf = hash[depth];
-
-  /* After this call secret state will be left in the context. The subsequent hashsig_keccak_prepare_hash call overwrites it. */
-  hashsig_keccak_stream(ctx->keccak_ctx, priv_leaves, LMFS_LEAVES * LDWM_SIG_LEN, ctx->priv, ctx->priv_len, hash, depth * LMFS_DEPTH_BYTES);
+  HASHSIG_STATS_COUNT(ctx->stats.trees);
+  HASHSIG_TRACE_BEGIN(lmfs_tree, depth);
 
-  /* Personalize hash function for current depth. Also overwrites secret state. */
-  hashsig_keccak_prepare_hash(ctx->keccak_ctx, LDWM_N, hash, depth);
+  /* Generate leaves and select target leaf from message hash. */
+  leaf = hashsig_lmfs_leaf(hash, depth);
+  hashsig_lmfs_tree_keys(ctx, hash, depth);
 
   /* Store hash selected leaf private key. */
   if (priv != NULL)
     memcpy(priv, priv_leaves + leaf * LDWM_SIG_LEN, LDWM_SIG_LEN);
 
   /* Generate public keys from private keys. */
-  for (i = 0; i < LMFS_LEAVES; i++)
-    hashsig_ldwm_public_key(ctx, priv_leaves + i * LDWM_SIG_LEN, pub_leaves + i * LDWM_N);
+  hashsig_lmfs_leaves(ctx, priv_leaves, pub_leaves, executor);
 
   /* Store hash selected leaf public key. */
   if (pub != NULL)
     memcpy(pub, pub_leaves + leaf * LDWM_N, LDWM_N);
 
   /* Build Merkle tree path and root node. */
+  HASHSIG_TRACE_BEGIN(merkle, depth);
+  HASHSIG_STATS_BEGIN();
   for (i = LMFS_LEAVES; i > 1; i >>= 1)
     for (j = 0; j < i; j += 2)
     {
@@ -94,109 +177,407 @@ void hashsig_lmfs_tree (hashsig_t *ctx, const uint8_t *hash, const uint8_t depth
       LDWM_H(pub_leaves + (j >> 1) * LDWM_N, pub_leaves + j * LDWM_N, LDWM_N * 2);
     }
 
+  HASHSIG_STATS_END(ctx, HASHSIG_PHASE_MERKLE, LMFS_LEAVES - 1);
+  HASHSIG_TRACE_END(merkle, depth);
+
   /* Store root of the Merkle tree. */
   memcpy(root_pub, pub_leaves, LDWM_N);
+  HASHSIG_TRACE_END(lmfs_tree, depth);
 }
 
-/* Returned value has to be freed using hashsig_free. */
-void hashsig_lmfs_sign (hashsig_t *ctx, uint8_t *sig, const uint8_t *message, const size_t len)
+/* Set the signature header and hash the message. */
+void hashsig_lmfs_message (hashsig_t *ctx, uint8_t *sig, uint8_t *hash, const uint8_t *message, const size_t len)
+{
+  HASHSIG_STATS_MARK
+
+  HASHSIG_STATS_COUNT(ctx->stats.signatures);
+
+  memcpy(sig, &ctx->type, LMFS_SIG_HEADER);
+
+  HASHSIG_TRACE_BEGIN(message, len);
+  HASHSIG_STATS_BEGIN();
+  ctx->backend->sighash(hash, LMFS_HASH_BYTES, ctx->pub, LDWM_N, message, len);
+  HASHSIG_STATS_END(ctx, HASHSIG_PHASE_MESSAGE, 1);
+  HASHSIG_TRACE_END(message, len);
+}
+
+/* Calculate the tree at depth and write the signature segment for it, which signs last. Then replace last with the root of the tree, to be signed by the tree above. */
+void hashsig_lmfs_sign_tree (hashsig_t *ctx, uint8_t *segment, const uint8_t *hash, uint8_t *last, const int depth)
 {
-  uint8_t *buf = sig;
-  uint8_t hash[LMFS_HASH_BYTES];
   uint8_t root[LDWM_N];
+
+  /* Generate leaves etc. */
+  hashsig_lmfs_tree(ctx, hash, depth, root, segment + LDWM_N + LDWM_SIG_LEN, segment + LDWM_N, segment, NULL);
+
+  /* Sign message or root of lower tree. */
+  hashsig_ldwm_sign(ctx, segment + LDWM_N, last, LDWM_N, 1);
+
+  /* Store current root as the next value to be signed. */
+  memcpy(last, root, LDWM_N);
+}
+
+/* If tree_done is not NULL, it is called with the number of finished trees after each one, and signing stops if it returns non-zero. Returns zero if the signature is complete. */
+int hashsig_lmfs_sign (hashsig_t *ctx, uint8_t *sig, const uint8_t *message, const size_t len, int (*tree_done) (void *arg, const size_t trees), void *arg)
+{
+  uint8_t *buf = sig + LMFS_SIG_HEADER;
+  uint8_t hash[LMFS_HASH_BYTES];
   uint8_t last[LDWM_N];
   int i;
 
-  /* Set signature header. */
-  memcpy(buf, &ctx->type, LMFS_SIG_HEADER);
-  buf += LMFS_SIG_HEADER;
-
   /* Hash message and set it up as the first value to be signed. */
-  hashsig_keccak_sighash(hash, LMFS_HASH_BYTES, ctx->pub, LDWM_N, message, len);
+  hashsig_lmfs_message(ctx, sig, hash, message, len);
   memcpy(last, hash, LDWM_N);
 
   /* Start at the deepest level. */
   for (i = LMFS_TREES - 1; i >= 0; i--)
   {
-    /* Generate leaves etc. */
-    hashsig_lmfs_tree(ctx, hash, i, root, buf + LDWM_N + LDWM_SIG_LEN, buf + LDWM_N, buf);
+    hashsig_lmfs_sign_tree(ctx, buf, hash, last, i);
 
-    /* Sign message or root of lower tree. */
-    hashsig_ldwm_sign(ctx, buf + LDWM_N, last, LDWM_N, 1);
+    /* Shift target buffer for the next part of the signature. */
+    buf += LMFS_SEG_LEN;
 
-    /* Store current root as the next value to be signed. */
-    memcpy(last, root, LDWM_N);
+    if (tree_done != NULL && tree_done(arg, LMFS_TREES - i))
+      return 1;
+  }
 
-    /* Shift target buffer for the next part of the signature. */
-    buf += LDWM_N + LDWM_SIG_LEN + LMFS_PATH_LEN;
+  return 0;
+}
+
+/* Tree-level task: each task takes the next tree to calculate until all are done, using its own context. */
+typedef struct
+{
+  hashsig_t *ctx;
+  const uint8_t *hash;
+  uint8_t *sig;
+  uint8_t (*roots)[LDWM_N];
+  size_t *next;
+} hashsig_lmfs_trees_task_t;
+
+static void hashsig_lmfs_trees_task (void *arg)
+{
+  hashsig_lmfs_trees_task_t *task = arg;
+  uint8_t *buf;
+  size_t i;
+
+  while ((i = __sync_fetch_and_add(task->next, 1)) < LMFS_TREES)
+  {
+    buf = task->sig + (LMFS_TREES - 1 - i) * LMFS_SEG_LEN;
+    hashsig_lmfs_tree(task->ctx, task->hash, i, task->roots[i], buf + LDWM_N + LDWM_SIG_LEN, buf + LDWM_N, buf, NULL);
   }
 }
 
-int hashsig_lmfs_verify (hashsig_t *ctx, const uint8_t *pub, const uint8_t *sig, const uint8_t *message, const size_t len)
+/* Same as hashsig_lmfs_sign, but calculating trees in parallel. The one-time signatures of the roots are cheap and made afterwards. */
+void hashsig_lmfs_sign_parallel (hashsig_t *ctx, uint8_t *sig, const uint8_t *message, const size_t len, const hashsig_executor_t *executor)
 {
+  uint8_t *buf = sig + LMFS_SIG_HEADER;
   uint8_t hash[LMFS_HASH_BYTES];
-  uint8_t last[LDWM_N];
-  uint8_t mt_buf[LDWM_N * 3];
-  uint16_t leaf;
-  int i, j;
+  uint8_t roots[LMFS_TREES][LDWM_N];
+  const uint8_t *last = hash;
+  hashsig_lmfs_trees_task_t tasks[LMFS_TREES];
+  size_t count, next = 0;
+  int i;
 
-  /* Check signature header. */
-  if (memcmp(sig, &ctx->type, LMFS_SIG_HEADER))
-      return -1;
-  sig += LMFS_SIG_HEADER;
+  hashsig_lmfs_message(ctx, sig, hash, message, len);
 
-  /* Hash message and set it up as the first value to be verified. */
-  hashsig_keccak_sighash(hash, LMFS_HASH_BYTES, pub, LDWM_N, message, len);
-  memcpy(last, hash, LDWM_N);
+  /* The first task uses ctx, the others clones sharing its key. */
+  count = hashsig_executor_concurrency(executor);
+  if (count > LMFS_TREES)
+    count = LMFS_TREES;
+  memset(tasks, 0, sizeof(tasks));
+  for (i = 0; i < (int)count; i++)
+  {
+    tasks[i].ctx = (i == 0) ? ctx : hashsig_clone_context(ctx);
+    if (tasks[i].ctx == NULL)
+      break;
+    /* Clones count from zero, ctx keeps its running statistics. */
+    if (i > 0)
+      HASHSIG_STATS_RESET(tasks[i].ctx);
+    tasks[i].hash = hash;
+    tasks[i].sig = buf;
+    tasks[i].roots = roots;
+    tasks[i].next = &next;
+  }
+  count = i;
 
-  /* Start at the deepest level. */
+  hashsig_run_tasks(executor, hashsig_lmfs_trees_task, tasks, sizeof(hashsig_lmfs_trees_task_t), count);
+
+  for (i = 1; i < (int)count; i++)
+  {
+    HASHSIG_STATS_ADD(ctx, tasks[i].ctx);
+    hashsig_destroy_context(tasks[i].ctx);
+  }
+
+  /* Sign message hash or root of lower tree, starting at the deepest level. */
   for (i = LMFS_TREES - 1; i >= 0; i--)
   {
-    /* Personalize hash function for current depth. */
-    hashsig_keccak_prepare_hash(ctx->keccak_ctx, LDWM_N, hash, i);
+    ctx->backend->prepare_hash(ctx->hash_ctx, LDWM_N, hash, i);
+    hashsig_ldwm_sign(ctx, buf + LDWM_N, last, LDWM_N, 1);
+    last = roots[i];
+    buf += LMFS_SEG_LEN;
+  }
+}
 
-    /* Verify LDWM signature on last public key or message hash. */
-    if (hashsig_ldwm_verify(ctx, sig, sig + LDWM_N, last, LDWM_N, 1))
-      return 1;
+/* Signature of a batch, sorted by message hash so signatures sharing trees are next to each other. */
+typedef struct
+{
+  uint8_t hash[LMFS_HASH_BYTES];
+  uint8_t roots[LMFS_TREES][LDWM_N];
+  uint8_t *sig;
+} hashsig_lmfs_batch_sig_t;
 
-    /* Apply Merkle tree path to hash to transform it to tree's root node. First, determine the current leaf's position. */
-    if (LMFS_TREE_HEIGHT == 16)
-      leaf = hashsig_load_le16(hash + i * 2);
-    else
-      leaf = hash[i];
+/* Tree at depth shared by count signatures starting at first, whose hashes agree on the prefix selecting it. */
+typedef struct
+{
+  size_t first;
+  size_t count;
+  int depth;
+} hashsig_lmfs_batch_tree_t;
+
+typedef struct
+{
+  hashsig_t *ctx;
+  hashsig_lmfs_batch_sig_t *sigs;
+  const hashsig_lmfs_batch_tree_t *trees;
+  size_t count;
+  size_t *next;
+} hashsig_lmfs_batch_task_t;
+
+static int hashsig_lmfs_batch_compare (const void *a, const void *b)
+{
+  return memcmp(((const hashsig_lmfs_batch_sig_t *)a)->hash, ((const hashsig_lmfs_batch_sig_t *)b)->hash, LMFS_HASH_BYTES);
+}
 
-    /* Copy the current hash into the middle of a three hash wide buffer. */
-    memcpy(mt_buf + LDWM_N, sig, LDWM_N);
+/* Calculate a tree once and write the public key, private key and Merkle tree path of the leaf selected by each of its signatures into their segments. All levels of the tree are kept, since the paths differ. */
+static void hashsig_lmfs_batch_tree (hashsig_t *ctx, hashsig_lmfs_batch_sig_t *sigs, const hashsig_lmfs_batch_tree_t *tree)
+{
+  uint8_t nodes[(LMFS_LEAVES - 1) * LDWM_N];
+  uint8_t *level, *parent, *buf;
+  const int depth = tree->depth;
+  size_t i, j, k;
+  uint16_t leaf;
+  HASHSIG_STATS_MARK
 
-    /* Advance signature buffer beyond public key and signature. */
-    sig += LDWM_N + LDWM_SIG_LEN;
+  HASHSIG_STATS_COUNT(ctx->stats.trees);
+  HASHSIG_TRACE_BEGIN(lmfs_tree, depth);
 
-    /* Follow Merkle tree path, starting on the bottom level. */
-    for (j = LMFS_LEAVES; j > 1; j >>= 1)
-    {
-      /* Check if position of current leaf is odd or even. */
-      if (leaf & 1)
-      {
-        /* Leaf is odd. Copy next path element to the left and hash. */
-        memcpy(mt_buf, sig, LDWM_N);
-        LDWM_H(mt_buf + LDWM_N, mt_buf, 2 * LDWM_N);
-      }
-      else
-      {
-        /* Leaf is even. Copy next path element to the right and hash. */
-        memcpy(mt_buf + 2 * LDWM_N, sig, LDWM_N);
-        LDWM_H(mt_buf + LDWM_N, mt_buf + LDWM_N, 2 * LDWM_N);
-      }
+  /* Store the private keys of the selected leaves before they are turned into public keys. */
+  hashsig_lmfs_tree_keys(ctx, sigs[tree->first].hash, depth);
+  for (k = tree->first; k < tree->first + tree->count; k++)
+  {
+    buf = sigs[k].sig + (LMFS_TREES - 1 - depth) * LMFS_SEG_LEN;
+    leaf = hashsig_lmfs_leaf(sigs[k].hash, depth);
+    memcpy(buf + LDWM_N, ctx->priv_scratch + leaf * LDWM_SIG_LEN, LDWM_SIG_LEN);
+  }
+  hashsig_lmfs_leaves(ctx, ctx->priv_scratch, ctx->pub_scratch, NULL);
 
-      /* Go up to next level and advance signature buffer over the current path element. */
+  /* Levels are stored one after another above the leaves, each half as long as the one below. */
+  HASHSIG_TRACE_BEGIN(merkle, depth);
+  HASHSIG_STATS_BEGIN();
+  level = ctx->pub_scratch;
+  parent = nodes;
+  for (i = LMFS_LEAVES; i > 1; i >>= 1)
+  {
+    for (j = 0; j < i; j += 2)
+      LDWM_H(parent + (j >> 1) * LDWM_N, level + j * LDWM_N, LDWM_N * 2);
+    level = parent;
+    parent += (i >> 1) * LDWM_N;
+  }
+  HASHSIG_STATS_END(ctx, HASHSIG_PHASE_MERKLE, LMFS_LEAVES - 1);
+  HASHSIG_TRACE_END(merkle, depth);
+
+  for (k = tree->first; k < tree->first + tree->count; k++)
+  {
+    buf = sigs[k].sig + (LMFS_TREES - 1 - depth) * LMFS_SEG_LEN;
+    leaf = hashsig_lmfs_leaf(sigs[k].hash, depth);
+    memcpy(buf, ctx->pub_scratch + leaf * LDWM_N, LDWM_N);
+
+    buf += LDWM_N + LDWM_SIG_LEN;
+    level = ctx->pub_scratch;
+    parent = nodes;
+    for (i = LMFS_LEAVES; i > 1; i >>= 1)
+    {
+      memcpy(buf, level + (leaf ^ 1) * LDWM_N, LDWM_N);
+      buf += LDWM_N;
       leaf >>= 1;
-      sig += LDWM_N;
+      level = parent;
+      parent += (i >> 1) * LDWM_N;
+    }
+
+    memcpy(sigs[k].roots[depth], level, LDWM_N);
+  }
+
+  HASHSIG_TRACE_END(lmfs_tree, depth);
+}
+
+static void hashsig_lmfs_batch_task (void *arg)
+{
+  hashsig_lmfs_batch_task_t *task = arg;
+  size_t i;
+
+  while ((i = __sync_fetch_and_add(task->next, 1)) < task->count)
+    hashsig_lmfs_batch_tree(task->ctx, task->sigs, &task->trees[i]);
+}
+
+/* Sign count messages at once. Trees only depend on the prefix of the message hash above them, so each distinct tree is calculated once for all signatures of the batch, in parallel on executor. The top tree is shared by all of them, and with more signatures, more of the trees below. */
+void hashsig_lmfs_sign_batch (hashsig_t *ctx, uint8_t *const *sig, const uint8_t *const *messages, const size_t *lens, const size_t count, const hashsig_executor_t *executor)
+{
+  hashsig_lmfs_batch_sig_t *sigs;
+  hashsig_lmfs_batch_tree_t *trees;
+  hashsig_lmfs_batch_task_t *tasks;
+  const uint8_t *last;
+  size_t n = 0, next = 0, tasks_count, i, j;
+  uint8_t *buf;
+  int depth;
+
+  if (count == 0)
+    return;
+
+  sigs = hashsig_calloc(count, sizeof(hashsig_lmfs_batch_sig_t));
+  trees = hashsig_calloc(count * LMFS_TREES, sizeof(hashsig_lmfs_batch_tree_t));
+  for (i = 0; i < count; i++)
+  {
+    hashsig_lmfs_message(ctx, sig[i], sigs[i].hash, messages[i], lens[i]);
+    sigs[i].sig = sig[i] + LMFS_SIG_HEADER;
+  }
+  qsort(sigs, count, sizeof(hashsig_lmfs_batch_sig_t), hashsig_lmfs_batch_compare);
+
+  /* Runs of equal prefixes form one tree each, largest first. */
+  for (depth = 0; depth < LMFS_TREES; depth++)
+    for (i = 0; i < count; i = j)
+    {
+      for (j = i + 1; j < count && !memcmp(sigs[i].hash, sigs[j].hash, depth * LMFS_DEPTH_BYTES); j++)
+        ;
+      trees[n].first = i;
+      trees[n].count = j - i;
+      trees[n].depth = depth;
+      n++;
+    }
+
+  /* The first task uses ctx, the others clones sharing its key. */
+  tasks_count = hashsig_executor_concurrency(executor);
+  if (tasks_count > n)
+    tasks_count = n;
+  tasks = hashsig_calloc(tasks_count, sizeof(hashsig_lmfs_batch_task_t));
+  for (i = 0; i < tasks_count; i++)
+  {
+    tasks[i].ctx = (i == 0) ? ctx : hashsig_clone_context(ctx);
+    if (tasks[i].ctx == NULL)
+      break;
+    /* Clones count from zero, ctx keeps its running statistics. */
+    if (i > 0)
+      HASHSIG_STATS_RESET(tasks[i].ctx);
+    tasks[i].sigs = sigs;
+    tasks[i].trees = trees;
+    tasks[i].count = n;
+    tasks[i].next = &next;
+  }
+  tasks_count = i;
+
+  hashsig_run_tasks(executor, hashsig_lmfs_batch_task, tasks, sizeof(hashsig_lmfs_batch_task_t), tasks_count);
+
+  for (i = 1; i < tasks_count; i++)
+  {
+    HASHSIG_STATS_ADD(ctx, tasks[i].ctx);
+    hashsig_destroy_context(tasks[i].ctx);
+  }
+
+  /* Sign message hash or root of lower tree, starting at the deepest level. */
+  for (i = 0; i < count; i++)
+  {
+    buf = sigs[i].sig;
+    last = sigs[i].hash;
+    for (depth = LMFS_TREES - 1; depth >= 0; depth--)
+    {
+      ctx->backend->prepare_hash(ctx->hash_ctx, LDWM_N, sigs[i].hash, depth);
+      hashsig_ldwm_sign(ctx, buf + LDWM_N, last, LDWM_N, 1);
+      last = sigs[i].roots[depth];
+      buf += LMFS_SEG_LEN;
     }
+  }
+
+  hashsig_free(tasks);
+  hashsig_free(trees);
+  hashsig_free(sigs);
+}
+
+/* Calculate the root of the tree at depth from the leaf public key and Merkle tree path in its signature segment. The hash function has to be personalized for depth. */
+void hashsig_lmfs_path_root (hashsig_t *ctx, const uint8_t *segment, const uint8_t *hash, uint8_t *root, const int depth)
+{
+  const uint8_t *sig = segment;
+  uint8_t mt_buf[LDWM_N * 3];
+  uint16_t leaf;
+  int j;
+
+  /* Apply Merkle tree path to hash to transform it to tree's root node. First, determine the current leaf's position. */
+  leaf = hashsig_lmfs_leaf(hash, depth);
+
+  /* Copy the current hash into the middle of a three hash wide buffer. */
+  memcpy(mt_buf + LDWM_N, sig, LDWM_N);
 
-    /* Make this tree's root node the next hash to check the signature of. */
-    memcpy(last, mt_buf + LDWM_N, LDWM_N);
+  /* Advance signature buffer beyond public key and signature. */
+  sig += LDWM_N + LDWM_SIG_LEN;
+
+  /* Follow Merkle tree path, starting on the bottom level. */
+  for (j = LMFS_LEAVES; j > 1; j >>= 1)
+  {
+    /* Check if position of current leaf is odd or even. */
+    if (leaf & 1)
+    {
+      /* Leaf is odd. Copy next path element to the left and hash. */
+      memcpy(mt_buf, sig, LDWM_N);
+      LDWM_H(mt_buf + LDWM_N, mt_buf, 2 * LDWM_N);
+    }
+    else
+    {
+      /* Leaf is even. Copy next path element to the right and hash. */
+      memcpy(mt_buf + 2 * LDWM_N, sig, LDWM_N);
+      LDWM_H(mt_buf + LDWM_N, mt_buf + LDWM_N, 2 * LDWM_N);
+    }
+
+    /* Go up to next level and advance signature buffer over the current path element. */
+    leaf >>= 1;
+    sig += LDWM_N;
   }
 
+  memcpy(root, mt_buf + LDWM_N, LDWM_N);
+}
+
+/* Verify the signature segment of the tree at depth, which signs last, and replace last with the root of the tree. Returns zero if valid. */
+int hashsig_lmfs_verify_segment (hashsig_t *ctx, const uint8_t *segment, const uint8_t *hash, uint8_t *last, const int depth)
+{
+  /* Personalize hash function for current depth. */
+  ctx->backend->prepare_hash(ctx->hash_ctx, LDWM_N, hash, depth);
+
+  /* Verify LDWM signature on last public key or message hash. */
+  if (hashsig_ldwm_verify(ctx, segment, segment + LDWM_N, last, LDWM_N, 1))
+    return 1;
+
+  /* Make this tree's root node the next hash to check the signature of. */
+  hashsig_lmfs_path_root(ctx, segment, hash, last, depth);
+
+  return 0;
+}
+
+int hashsig_lmfs_verify (hashsig_t *ctx, const uint8_t *pub, const uint8_t *sig, const uint8_t *message, const size_t len)
+{
+  uint8_t hash[LMFS_HASH_BYTES];
+  uint8_t last[LDWM_N];
+  int i;
+
+  /* Check signature header. */
+  if (memcmp(sig, &ctx->type, LMFS_SIG_HEADER))
+      return -1;
+  sig += LMFS_SIG_HEADER;
+
+  /* Hash message and set it up as the first value to be verified. */
+  ctx->backend->sighash(hash, LMFS_HASH_BYTES, pub, LDWM_N, message, len);
+  memcpy(last, hash, LDWM_N);
+
+  /* Start at the deepest level. */
+  for (i = LMFS_TREES - 1; i >= 0; i--, sig += LMFS_SEG_LEN)
+    if (hashsig_lmfs_verify_segment(ctx, sig, hash, last, i))
+      return 1;
+
   /* If it can be proven that the last public key is part of the Merkle tree, for which the public key is the root node, the signature is valid. */
   if (memcmp(last, pub, LDWM_N))
     return 1;
@@ -205,13 +586,13 @@ int hashsig_lmfs_verify (hashsig_t *ctx, const uint8_t *pub, const uint8_t *sig,
   return 0;
 }
 
-void hashsig_lmfs_public_key (hashsig_t *ctx, uint8_t *pub)
+void hashsig_lmfs_public_key (hashsig_t *ctx, uint8_t *pub, const hashsig_executor_t *executor)
 {
   uint8_t hash[LMFS_HASH_BYTES] = { 0 };
 
   /* Personalize hash function for current depth. */
-  hashsig_keccak_prepare_hash(ctx->keccak_ctx, LDWM_N, NULL, 0);
+  ctx->backend->prepare_hash(ctx->hash_ctx, LDWM_N, NULL, 0);
 
   /* Calculate root node for top-most Merkle tree to use as public key. */
-  hashsig_lmfs_tree(ctx, hash, 0, pub, NULL, NULL, NULL);
+  hashsig_lmfs_tree(ctx, hash, 0, pub, NULL, NULL, NULL, executor);
 }
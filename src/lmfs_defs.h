@@ -43,11 +43,22 @@
 #define LMFS_LEAVES (1 << LMFS_TREE_HEIGHT)
 #define LMFS_PATH_LEN (LMFS_TREE_HEIGHT * LDWM_N)
 #define LMFS_SIG_HEADER 1
+#define LMFS_SEG_LEN (LDWM_N + LDWM_SIG_LEN + LMFS_PATH_LEN)
 #define LMFS_SIG_LEN (LMFS_TREES * LMFS_PATH_LEN + LMFS_TREES * LDWM_N + LMFS_TREES * LDWM_SIG_LEN + LMFS_SIG_HEADER)
 
-void hashsig_lmfs_tree (hashsig_t *ctx, const uint8_t *hash, const uint8_t depth, uint8_t *root_pub, uint8_t *mt_path, uint8_t *priv, uint8_t *pub);
-void hashsig_lmfs_sign (hashsig_t *ctx, uint8_t *sig, const uint8_t *message, const size_t len);
+/* The one parameter set compiled in, as the low bits of the type. Types of any hash function family with these bits are supported. */
+#define LMFS_TYPE_PARAMS (LDWM_TYPE_W | LDWM_TYPE_MN | ((LMFS_TREE_HEIGHT == 16) ? 0x10 : 0x00))
+
+/* Functions taking an executor split their work into tasks run by it, or run sequentially if it is NULL. */
+void hashsig_lmfs_tree (hashsig_t *ctx, const uint8_t *hash, const uint8_t depth, uint8_t *root_pub, uint8_t *mt_path, uint8_t *priv, uint8_t *pub, const hashsig_executor_t *executor);
+void hashsig_lmfs_message (hashsig_t *ctx, uint8_t *sig, uint8_t *hash, const uint8_t *message, const size_t len);
+void hashsig_lmfs_sign_tree (hashsig_t *ctx, uint8_t *segment, const uint8_t *hash, uint8_t *last, const int depth);
+int hashsig_lmfs_sign (hashsig_t *ctx, uint8_t *sig, const uint8_t *message, const size_t len, int (*tree_done) (void *arg, const size_t trees), void *arg);
+void hashsig_lmfs_sign_parallel (hashsig_t *ctx, uint8_t *sig, const uint8_t *message, const size_t len, const hashsig_executor_t *executor);
+void hashsig_lmfs_sign_batch (hashsig_t *ctx, uint8_t *const *sig, const uint8_t *const *messages, const size_t *lens, const size_t count, const hashsig_executor_t *executor);
+void hashsig_lmfs_path_root (hashsig_t *ctx, const uint8_t *segment, const uint8_t *hash, uint8_t *root, const int depth);
+int hashsig_lmfs_verify_segment (hashsig_t *ctx, const uint8_t *segment, const uint8_t *hash, uint8_t *last, const int depth);
 int hashsig_lmfs_verify (hashsig_t *ctx, const uint8_t *pub, const uint8_t *sig, const uint8_t *message, const size_t len);
-void hashsig_lmfs_public_key (hashsig_t *ctx, uint8_t *pub);
+void hashsig_lmfs_public_key (hashsig_t *ctx, uint8_t *pub, const hashsig_executor_t *executor);
 
 #endif /* LMFS_DEFS_H */
@@ -0,0 +1,202 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Resumable signing */
+
+#include <assert.h>
+#include <string.h>
+
+#include "hashsig_defs.h"
+#include "hashsig.h"
+#include "ldwm_defs.h"
+#include "lmfs_defs.h"
+#include "util.h"
+
+/* Serialized state: type, format version, number of finished trees, public key, message hash, the finished segments of the signature and a tag. The root of the last finished tree is not stored, but recalculated from the segments when loading. The tag is keyed with the private key and covers the Merkle path of the last segment, which nothing else does, so a damaged state cannot make a one-time key sign anything but the real root. */
+#define HASHSIG_SIGN_STATE_VERSION 2
+#define HASHSIG_SIGN_STATE_HEADER (3 + LDWM_N + LMFS_HASH_BYTES)
+#define HASHSIG_SIGN_STATE_TAG LDWM_N
+
+struct hashsig_sign_state_s
+{
+  uint8_t type;
+  size_t done;
+  uint8_t pub[LDWM_N];
+  uint8_t hash[LMFS_HASH_BYTES];
+  uint8_t last[LDWM_N];
+  uint8_t tag[HASHSIG_SIGN_STATE_TAG];
+  uint8_t *sig;
+};
+
+static hashsig_sign_state_t *hashsig_sign_state_alloc (void)
+{
+  char *buf = hashsig_calloc(1, sizeof(hashsig_sign_state_t) + LMFS_SIG_LEN);
+  hashsig_sign_state_t *state = (hashsig_sign_state_t *)buf;
+
+  state->sig = (uint8_t *)buf + sizeof(hashsig_sign_state_t);
+
+  return state;
+}
+
+/* Calculate the tag of the serialized state. The key is derived from the private key with the full message hash as nonce, which trees never use. */
+static void hashsig_sign_state_tag (hashsig_t *ctx, const hashsig_sign_state_t *state, uint8_t *tag)
+{
+  uint8_t key[LDWM_N];
+  uint8_t header[3];
+
+  ctx->backend->stream(ctx->hash_ctx, key, LDWM_N, ctx->priv, ctx->priv_len, state->hash, LMFS_HASH_BYTES);
+
+  header[0] = state->type;
+  header[1] = HASHSIG_SIGN_STATE_VERSION;
+  header[2] = (uint8_t)state->done;
+  ctx->backend->sighash_init(ctx->hash_ctx, HASHSIG_SIGN_STATE_TAG, key, LDWM_N);
+  ctx->backend->sighash_update(ctx->hash_ctx, header, sizeof(header));
+  ctx->backend->sighash_update(ctx->hash_ctx, state->pub, LDWM_N);
+  ctx->backend->sighash_update(ctx->hash_ctx, state->hash, LMFS_HASH_BYTES);
+  ctx->backend->sighash_update(ctx->hash_ctx, state->sig + LMFS_SIG_HEADER, state->done * LMFS_SEG_LEN);
+  ctx->backend->sighash_final(ctx->hash_ctx, tag);
+
+  memset(key, 0, LDWM_N);
+}
+
+hashsig_sign_state_t *hashsig_sign_start (hashsig_t *ctx, const uint8_t *message, const size_t len)
+{
+  hashsig_sign_state_t *state;
+
+  hashsig_assert_ctx(ctx);
+
+  state = hashsig_sign_state_alloc();
+  state->type = ctx->type;
+  memcpy(state->pub, ctx->pub, LDWM_N);
+
+  /* Hash message and set it up as the first value to be signed. */
+  hashsig_lmfs_message(ctx, state->sig, state->hash, message, len);
+  memcpy(state->last, state->hash, LDWM_N);
+  hashsig_sign_state_tag(ctx, state, state->tag);
+
+  return state;
+}
+
+size_t hashsig_sign_continue (hashsig_t *ctx, hashsig_sign_state_t *state, size_t trees)
+{
+  hashsig_assert_ctx(ctx);
+  assert(ctx->type == state->type && !memcmp(ctx->pub, state->pub, LDWM_N));
+
+  if (trees == 0 || trees > LMFS_TREES - state->done)
+    trees = LMFS_TREES - state->done;
+
+  /* Continue below the trees already finished, which are the deepest. */
+  for (; trees > 0; trees--, state->done++)
+    hashsig_lmfs_sign_tree(ctx, state->sig + LMFS_SIG_HEADER + state->done * LMFS_SEG_LEN, state->hash, state->last, LMFS_TREES - 1 - state->done);
+  hashsig_sign_state_tag(ctx, state, state->tag);
+
+  return LMFS_TREES - state->done;
+}
+
+size_t hashsig_sign_state2buf (const hashsig_sign_state_t *state, uint8_t *buf, const size_t len)
+{
+  const size_t segments = state->done * LMFS_SEG_LEN;
+
+  if (len < HASHSIG_SIGN_STATE_HEADER + segments + HASHSIG_SIGN_STATE_TAG)
+    return HASHSIG_SIGN_STATE_HEADER + segments + HASHSIG_SIGN_STATE_TAG;
+
+  buf[0] = state->type;
+  buf[1] = HASHSIG_SIGN_STATE_VERSION;
+  buf[2] = (uint8_t)state->done;
+  buf += 3;
+  memcpy(buf, state->pub, LDWM_N);
+  buf += LDWM_N;
+  memcpy(buf, state->hash, LMFS_HASH_BYTES);
+  buf += LMFS_HASH_BYTES;
+  memcpy(buf, state->sig + LMFS_SIG_HEADER, segments);
+  buf += segments;
+  memcpy(buf, state->tag, HASHSIG_SIGN_STATE_TAG);
+
+  return 0;
+}
+
+size_t hashsig_buf2sign_state (hashsig_t *ctx, hashsig_sign_state_t **state_ptr, const uint8_t *buf, const size_t len)
+{
+  hashsig_sign_state_t *state;
+  size_t i;
+
+  hashsig_assert_ctx(ctx);
+
+  *state_ptr = NULL;
+
+  /* The state has to belong to the key of ctx. */
+  if (len < HASHSIG_SIGN_STATE_HEADER || buf[0] != ctx->type || buf[1] != HASHSIG_SIGN_STATE_VERSION || buf[2] > LMFS_TREES || memcmp(buf + 3, ctx->pub, LDWM_N))
+    return HASHSIG_SIGN_STATE_HEADER;
+  if (len != HASHSIG_SIGN_STATE_HEADER + buf[2] * LMFS_SEG_LEN + HASHSIG_SIGN_STATE_TAG)
+    return HASHSIG_SIGN_STATE_HEADER + buf[2] * LMFS_SEG_LEN + HASHSIG_SIGN_STATE_TAG;
+
+  state = hashsig_sign_state_alloc();
+  state->type = buf[0];
+  state->done = buf[2];
+  buf += 3;
+  memcpy(state->pub, buf, LDWM_N);
+  buf += LDWM_N;
+  memcpy(state->hash, buf, LMFS_HASH_BYTES);
+  buf += LMFS_HASH_BYTES;
+  state->sig[0] = state->type;
+  memcpy(state->sig + LMFS_SIG_HEADER, buf, state->done * LMFS_SEG_LEN);
+  buf += state->done * LMFS_SEG_LEN;
+
+  /* The tag has to match before anything in the state is used. */
+  hashsig_sign_state_tag(ctx, state, state->tag);
+  if (memcmp(state->tag, buf, HASHSIG_SIGN_STATE_TAG))
+  {
+    hashsig_free(state);
+    return HASHSIG_SIGN_STATE_HEADER;
+  }
+
+  /* Recalculate the root of the last finished tree by verifying the finished segments, starting from the message hash. */
+  memcpy(state->last, state->hash, LDWM_N);
+  for (i = 0; i < state->done; i++)
+    if (hashsig_lmfs_verify_segment(ctx, state->sig + LMFS_SIG_HEADER + i * LMFS_SEG_LEN, state->hash, state->last, LMFS_TREES - 1 - i))
+    {
+      hashsig_free(state);
+      return HASHSIG_SIGN_STATE_HEADER;
+    }
+
+  *state_ptr = state;
+  return 0;
+}
+
+size_t hashsig_sign_state2sig (const hashsig_sign_state_t *state, uint8_t *buf, const size_t len)
+{
+  if (state->done < LMFS_TREES)
+    return 1;
+  if (len < LMFS_SIG_LEN)
+    return LMFS_SIG_LEN;
+
+  memcpy(buf, state->sig, LMFS_SIG_LEN);
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hashsig.h"
+#include "sha256_internal.h"
+#include "util.h"
+
+
+/* Test program */
+
+void dump_hex (const uint8_t *buf, const size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    printf("%02x", buf[i]);
+  printf("\n");
+}
+
+/* Hash a message with plain SHA-256 in two parts. */
+void dump_sha256 (const uint8_t *msg, const size_t len)
+{
+  uint8_t hash[SHA256_HASH_BYTES];
+  sha256_ctx_t ctx;
+
+  hashsig_sha256_init(&ctx);
+  hashsig_sha256_update(&ctx, msg, len / 3);
+  hashsig_sha256_update(&ctx, msg + len / 3, len - len / 3);
+  hashsig_sha256_final(&ctx, hash);
+  dump_hex(hash, sizeof(hash));
+}
+
+/* Compare hashing with the compression functions selected by features against the portable one, one lane at a time. */
+int check_multi (const size_t out_len, const size_t msg_len, const int features)
+{
+  static const uint8_t nonce[3] = { 0x01, 0x02, 0x03 };
+  uint8_t msg[8][300];
+  uint8_t hash[8][SHA256_HASH_BYTES];
+  uint8_t expected[SHA256_HASH_BYTES];
+  uint8_t *out[8];
+  const uint8_t *in[8];
+  sha256_ctx_t prepared;
+  size_t i, l;
+
+  hashsig_sha256_features = 0;
+  hashsig_sha256_prepare_hash(&prepared, out_len, nonce, sizeof(nonce));
+
+  for (l = 0; l < 8; l++)
+  {
+    for (i = 0; i < msg_len; i++)
+      msg[l][i] = (uint8_t)(l * 31 + i);
+    out[l] = hash[l];
+    in[l] = msg[l];
+  }
+
+  hashsig_sha256_features = features;
+  hashsig_sha256_hash_x8(&prepared, out, in, msg_len);
+
+  for (l = 0; l < 8; l++)
+  {
+    hashsig_sha256_features = features;
+    hashsig_sha256_hash(&prepared, expected, msg[l], msg_len);
+    if (memcmp(expected, hash[l], out_len))
+      return 1;
+    hashsig_sha256_features = 0;
+    hashsig_sha256_hash(&prepared, expected, msg[l], msg_len);
+    if (memcmp(expected, hash[l], out_len))
+      return 1;
+  }
+
+  return 0;
+}
+
+/* Check one set of compression functions, if the CPU supports it. SHA-NI hashes the eight lanes one after the other, AVX2 and the portable variant all at once. */
+void check_features (const int features, const char *name)
+{
+  const int detected = hashsig_sha256_features;
+  int failed = 0;
+
+  if (features == 0 || hashsig_cpu_supports(features))
+    failed = check_multi(32, 0, features) || check_multi(32, 32, features) || check_multi(32, 64, features) || check_multi(20, 300, features);
+  hashsig_sha256_features = detected;
+
+  if (!failed)
+    printf("Successfully compared %s hashing.\n", name);
+  else
+    printf("Failure at comparing %s hashing.\n", name);
+}
+
+int main (int argc, char *argv[])
+{
+  uint8_t msg[1000];
+  uint8_t stream[100];
+  sha256_ctx_t ctx;
+  size_t i;
+
+  /* FIPS 180-4 examples. */
+  dump_sha256((const uint8_t *)"abc", 3);
+  dump_sha256((const uint8_t *)"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56);
+
+  /* Lengths around the padding boundary and several blocks. */
+  for (i = 0; i < sizeof(msg); i++)
+    msg[i] = (uint8_t)(i * 7 + 3);
+  dump_sha256(msg, 55);
+  dump_sha256(msg, 64);
+  dump_sha256(msg, 1000);
+
+  /* Personalized key stream. */
+  hashsig_sha256_stream(&ctx, stream, sizeof(stream), msg, 32, msg + 32, 5);
+  dump_hex(stream, sizeof(stream));
+
+  /* Check each compression function with short, block sized, long messages and truncated output. */
+  check_features(0, "portable eight lane");
+  check_features(HASHSIG_CPU_AVX2, "AVX2 eight lane");
+  check_features(HASHSIG_CPU_SHA, "SHA-NI");
+
+  return 0;
+}
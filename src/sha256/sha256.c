@@ -0,0 +1,346 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/****************************************************************************
+ *
+ * Implementation of the SHA-256 hash function (FIPS 180-4).
+ *
+ * On x86-64, the compression function uses the SHA extensions (SHA-NI) when
+ * the CPU supports them.
+ *
+ ****************************************************************************/
+
+#include <string.h>
+#include <assert.h>
+#include "sha256_internal.h"
+#include "util.h"
+#include "stats.h"
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define SHA256_X86
+#include <immintrin.h>
+#endif
+
+const uint32_t hashsig_sha256_k[64] =
+{
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+int hashsig_sha256_features = 0;
+
+#ifdef SHA256_X86
+/* Runs when the library is loaded, before any thread can hash. */
+__attribute__ ((constructor)) static void hashsig_sha256_detect (void)
+{
+  hashsig_sha256_features = (hashsig_cpu_supports(HASHSIG_CPU_SHA) ? HASHSIG_CPU_SHA : 0) | (hashsig_cpu_supports(HASHSIG_CPU_AVX2) ? HASHSIG_CPU_AVX2 : 0);
+}
+#endif
+
+static const uint32_t sha256_iv[SHA256_STATE_WORDS] =
+{
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static void hashsig_sha256_compress_portable (uint32_t h[SHA256_STATE_WORDS], const uint8_t *blocks, size_t count)
+{
+  uint32_t w[64];
+  uint32_t a, b, c, d, e, f, g, k, t1, t2;
+  size_t i;
+
+  while (count--)
+  {
+    /* Prepare message schedule. */
+    for (i = 0; i < 16; i++)
+      w[i] = hashsig_load_be32(blocks + i * 4);
+    for (i = 16; i < 64; i++)
+      w[i] = SSIG1(w[i - 2]) + w[i - 7] + SSIG0(w[i - 15]) + w[i - 16];
+
+    a = h[0];
+    b = h[1];
+    c = h[2];
+    d = h[3];
+    e = h[4];
+    f = h[5];
+    g = h[6];
+    k = h[7];
+
+    for (i = 0; i < 64; i++)
+    {
+      t1 = k + BSIG1(e) + CH(e, f, g) + hashsig_sha256_k[i] + w[i];
+      t2 = BSIG0(a) + MAJ(a, b, c);
+      k = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += k;
+
+    blocks += SHA256_BLOCK_BYTES;
+  }
+}
+
+#ifdef SHA256_X86
+#pragma GCC push_options
+#pragma GCC target("sha,sse4.1")
+
+/* Four rounds, starting at round 4 * t, with message schedule kept in four registers. */
+#define SHA256_NI_ROUNDS(t)                                                                          \
+  {                                                                                                  \
+    msg = _mm_add_epi32(m[(t) % 4], _mm_loadu_si128((const __m128i *)(hashsig_sha256_k + 4 * (t)))); \
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);                                             \
+    if ((t) >= 3 && (t) <= 14)                                                                       \
+    {                                                                                                \
+      tmp = _mm_alignr_epi8(m[(t) % 4], m[((t) + 3) % 4], 4);                                        \
+      m[((t) + 1) % 4] = _mm_add_epi32(m[((t) + 1) % 4], tmp);                                       \
+      m[((t) + 1) % 4] = _mm_sha256msg2_epu32(m[((t) + 1) % 4], m[(t) % 4]);                         \
+    }                                                                                                \
+    msg = _mm_shuffle_epi32(msg, 0x0e);                                                              \
+    state0 = _mm_sha256rnds2_epu32(state0, state1, msg);                                             \
+    if ((t) >= 1 && (t) <= 12)                                                                       \
+      m[((t) + 3) % 4] = _mm_sha256msg1_epu32(m[((t) + 3) % 4], m[(t) % 4]);                         \
+  }
+
+static void hashsig_sha256_compress_shani (uint32_t h[SHA256_STATE_WORDS], const uint8_t *blocks, size_t count)
+{
+  const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i state0, state1, save0, save1, msg, tmp;
+  __m128i m[4];
+
+  /* Reorder state words into ABEF and CDGH. */
+  tmp = _mm_loadu_si128((const __m128i *)&h[0]);
+  state1 = _mm_loadu_si128((const __m128i *)&h[4]);
+  tmp = _mm_shuffle_epi32(tmp, 0xb1);
+  state1 = _mm_shuffle_epi32(state1, 0x1b);
+  state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+  while (count--)
+  {
+    save0 = state0;
+    save1 = state1;
+
+    m[0] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 0)), mask);
+    m[1] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 16)), mask);
+    m[2] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 32)), mask);
+    m[3] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 48)), mask);
+
+    SHA256_NI_ROUNDS(0);
+    SHA256_NI_ROUNDS(1);
+    SHA256_NI_ROUNDS(2);
+    SHA256_NI_ROUNDS(3);
+    SHA256_NI_ROUNDS(4);
+    SHA256_NI_ROUNDS(5);
+    SHA256_NI_ROUNDS(6);
+    SHA256_NI_ROUNDS(7);
+    SHA256_NI_ROUNDS(8);
+    SHA256_NI_ROUNDS(9);
+    SHA256_NI_ROUNDS(10);
+    SHA256_NI_ROUNDS(11);
+    SHA256_NI_ROUNDS(12);
+    SHA256_NI_ROUNDS(13);
+    SHA256_NI_ROUNDS(14);
+    SHA256_NI_ROUNDS(15);
+
+    state0 = _mm_add_epi32(state0, save0);
+    state1 = _mm_add_epi32(state1, save1);
+
+    blocks += SHA256_BLOCK_BYTES;
+  }
+
+  /* Restore state word order. */
+  tmp = _mm_shuffle_epi32(state0, 0x1b);
+  state1 = _mm_shuffle_epi32(state1, 0xb1);
+  state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+  state1 = _mm_alignr_epi8(state1, tmp, 8);
+  _mm_storeu_si128((__m128i *)&h[0], state0);
+  _mm_storeu_si128((__m128i *)&h[4], state1);
+}
+
+#pragma GCC pop_options
+#endif
+
+void hashsig_sha256_compress (uint32_t h[SHA256_STATE_WORDS], const uint8_t *blocks, size_t count)
+{
+  HASHSIG_STATS_PERMUTATIONS(count);
+#ifdef SHA256_X86
+  if (hashsig_sha256_features & HASHSIG_CPU_SHA)
+  {
+    hashsig_sha256_compress_shani(h, blocks, count);
+    return;
+  }
+#endif
+  hashsig_sha256_compress_portable(h, blocks, count);
+}
+
+void hashsig_sha256_init (sha256_ctx_t *ctx)
+{
+  memcpy(ctx->h, sha256_iv, sizeof(ctx->h));
+  ctx->hashLen = SHA256_HASH_BYTES;
+  ctx->bCnt = 0;
+  ctx->len = 0;
+}
+
+void hashsig_sha256_update (sha256_ctx_t *ctx, const uint8_t *msg, size_t msg_len)
+{
+  size_t n;
+
+  assert(ctx->bCnt < SHA256_BLOCK_BYTES); /* catch uninitialized context */
+  ctx->len += msg_len;
+
+  /* Finish up any buffered message data. */
+  if (ctx->bCnt)
+  {
+    n = SHA256_BLOCK_BYTES - ctx->bCnt;
+    if (n > msg_len)
+      n = msg_len;
+    memcpy(ctx->b + ctx->bCnt, msg, n);
+    ctx->bCnt += n;
+    msg += n;
+    msg_len -= n;
+    if (ctx->bCnt < SHA256_BLOCK_BYTES)
+      return;
+    hashsig_sha256_compress(ctx->h, ctx->b, 1);
+    ctx->bCnt = 0;
+  }
+
+  /* Process full blocks directly from the message. */
+  if (msg_len >= SHA256_BLOCK_BYTES)
+  {
+    n = msg_len / SHA256_BLOCK_BYTES;
+    hashsig_sha256_compress(ctx->h, msg, n);
+    msg += n * SHA256_BLOCK_BYTES;
+    msg_len -= n * SHA256_BLOCK_BYTES;
+  }
+
+  /* Buffer the rest. */
+  memcpy(ctx->b, msg, msg_len);
+  ctx->bCnt = msg_len;
+}
+
+void hashsig_sha256_final (sha256_ctx_t *ctx, uint8_t *out)
+{
+  uint8_t hash[SHA256_HASH_BYTES];
+  size_t i;
+
+  assert(ctx->bCnt < SHA256_BLOCK_BYTES); /* catch uninitialized context */
+
+  /* Pad with a one bit, zeros and the message length in bits. */
+  ctx->b[ctx->bCnt++] = 0x80;
+  if (ctx->bCnt > SHA256_BLOCK_BYTES - 8)
+  {
+    memset(ctx->b + ctx->bCnt, 0, SHA256_BLOCK_BYTES - ctx->bCnt);
+    hashsig_sha256_compress(ctx->h, ctx->b, 1);
+    ctx->bCnt = 0;
+  }
+  memset(ctx->b + ctx->bCnt, 0, SHA256_BLOCK_BYTES - 8 - ctx->bCnt);
+  hashsig_store_be64(ctx->b + SHA256_BLOCK_BYTES - 8, ctx->len * 8);
+  hashsig_sha256_compress(ctx->h, ctx->b, 1);
+
+  for (i = 0; i < SHA256_STATE_WORDS; i++)
+    hashsig_store_be32(hash + i * 4, ctx->h[i]);
+  memcpy(out, hash, ctx->hashLen);
+}
+
+/* The personalization and nonce fill exactly one block, so that every hash only needs to process the message on top of the prepared chaining variables. */
+void hashsig_sha256_prepare_hash (sha256_ctx_t *ctx, size_t len, const uint8_t *nonce, size_t nonce_len)
+{
+  static const uint8_t personalization[8] = { 'H', 'A', 'S', 'H', 'S', 'I', 'G', 'H' };
+  uint8_t block[SHA256_BLOCK_BYTES] = { 0 };
+
+  assert(len > 0 && len <= SHA256_HASH_BYTES);
+  assert(nonce_len <= SHA256_BLOCK_BYTES - sizeof(personalization) - 1);
+
+  memcpy(block, personalization, sizeof(personalization));
+  block[sizeof(personalization)] = nonce_len;
+  if (nonce_len)
+    memcpy(block + sizeof(personalization) + 1, nonce, nonce_len);
+
+  hashsig_sha256_init(ctx);
+  hashsig_sha256_update(ctx, block, sizeof(block));
+  ctx->hashLen = len;
+}
+
+void hashsig_sha256_hash (sha256_ctx_t *prepared, uint8_t *out, const uint8_t *msg, size_t msg_len)
+{
+  sha256_ctx_t ctx;
+
+  memcpy(&ctx, prepared, sizeof(ctx));
+  hashsig_sha256_update(&ctx, msg, msg_len);
+  hashsig_sha256_final(&ctx, out);
+}
+
+/* The message is then added with hashsig_sha256_update and the hash obtained with hashsig_sha256_final. */
+void hashsig_sha256_sighash_init (sha256_ctx_t *ctx, size_t len, const uint8_t *pub, size_t pub_len)
+{
+  static const uint8_t sig_pub_separator[8] = { 'H', 'A', 'S', 'H', 'S', 'I', 'G', 'S' };
+  uint8_t len_buf[8];
+
+  assert(len > 0 && len <= SHA256_HASH_BYTES);
+  assert(pub != NULL);
+
+  hashsig_sha256_init(ctx);
+  ctx->hashLen = len;
+
+  /* Add the public key to the message for personalization purposes. */
+  hashsig_store_le64(len_buf, pub_len);
+  hashsig_sha256_update(ctx, sig_pub_separator, sizeof(sig_pub_separator));
+  hashsig_sha256_update(ctx, len_buf, sizeof(len_buf));
+  hashsig_sha256_update(ctx, pub, pub_len);
+  hashsig_sha256_update(ctx, sig_pub_separator, sizeof(sig_pub_separator));
+}
+
+void hashsig_sha256_sighash (uint8_t *out, size_t len, const uint8_t *pub, size_t pub_len, const uint8_t *msg, size_t msg_len)
+{
+  sha256_ctx_t ctx;
+
+  assert(msg != NULL);
+
+  hashsig_sha256_sighash_init(&ctx, len, pub, pub_len);
+  hashsig_sha256_update(&ctx, msg, msg_len);
+  hashsig_sha256_final(&ctx, out);
+}
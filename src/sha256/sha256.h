@@ -0,0 +1,70 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_STATE_WORDS 8
+#define SHA256_BLOCK_BYTES 64
+#define SHA256_HASH_BYTES  32
+#define SHA256_MAX_LANES   8
+
+/* SHA-256 hash context structure. */
+typedef struct
+{
+  size_t hashLen;                   /* Size of hash result, in bytes.        */
+  size_t bCnt;                      /* Current byte count in buffer b[].     */
+  uint64_t len;                     /* Total number of bytes processed.      */
+  uint32_t h[SHA256_STATE_WORDS];   /* Chaining variables.                   */
+  uint8_t b[SHA256_BLOCK_BYTES];    /* Partial block buffer.                 */
+} sha256_ctx_t;
+
+/* Plain SHA-256. */
+void hashsig_sha256_init (sha256_ctx_t *ctx);
+void hashsig_sha256_update (sha256_ctx_t *ctx, const uint8_t *msg, size_t msg_len);
+void hashsig_sha256_final (sha256_ctx_t *ctx, uint8_t *out);
+
+/* Compression functions. The single block variant uses SHA-NI when available, the multi-lane variant processes one block for each of eight states at once. */
+void hashsig_sha256_compress (uint32_t h[SHA256_STATE_WORDS], const uint8_t *blocks, size_t count);
+void hashsig_sha256_compress_x8 (uint32_t h[SHA256_STATE_WORDS][SHA256_MAX_LANES], const uint8_t *const blocks[SHA256_MAX_LANES]);
+
+/* Personalized functions for use by libhashsig. See keccak.h and skein.h. */
+void hashsig_sha256_prepare_hash (sha256_ctx_t *ctx, size_t len, const uint8_t *nonce, size_t nonce_len);
+void hashsig_sha256_hash (sha256_ctx_t *prepared, uint8_t *out, const uint8_t *msg, size_t msg_len);
+void hashsig_sha256_hash_x8 (sha256_ctx_t *prepared, uint8_t *out[8], const uint8_t *const msg[8], size_t msg_len);
+void hashsig_sha256_sighash_init (sha256_ctx_t *ctx, size_t len, const uint8_t *pub, size_t pub_len);
+void hashsig_sha256_sighash (uint8_t *out, size_t len, const uint8_t *pub, size_t pub_len, const uint8_t *msg, size_t msg_len);
+
+/* After this call secret state will be left in the context. Make sure to use the context for something else after use. */
+void hashsig_sha256_stream (sha256_ctx_t *ctx, uint8_t *out, size_t len, const uint8_t *key, size_t key_len, const uint8_t *nonce, size_t nonce_len);
+
+#endif /* SHA256_H */
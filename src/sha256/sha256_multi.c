@@ -0,0 +1,235 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/****************************************************************************
+ *
+ * Multi-lane SHA-256 for hashing eight messages of equal length at once.
+ *
+ * The compression function is computed on vectors holding one word of each
+ * lane. On x86-64, a variant for AVX2 is selected at runtime, unless the CPU
+ * supports SHA-NI, which is faster even one lane at a time.
+ *
+ ****************************************************************************/
+
+#include <string.h>
+#include <assert.h>
+#include "sha256_internal.h"
+#include "util.h"
+#include "stats.h"
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define SHA256_MULTI_X86
+#endif
+
+typedef uint32_t sha256_u32x8_t __attribute__ ((vector_size (32)));
+
+/* Portable compression function. */
+#define SHA256_MULTI_NAME hashsig_sha256_compress_x8_portable
+#include "sha256_multi.macros"
+#undef SHA256_MULTI_NAME
+
+#ifdef SHA256_MULTI_X86
+/* AVX2 compression function. A 256 bit register holds one word of all eight lanes. */
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#define SHA256_MULTI_NAME hashsig_sha256_compress_x8_avx2
+#include "sha256_multi.macros"
+#undef SHA256_MULTI_NAME
+#pragma GCC pop_options
+#endif
+
+/* One lane after the other, for when single block compression is faster than the vectorized variants. */
+static void hashsig_sha256_compress_x8_serial (uint32_t h[SHA256_STATE_WORDS][SHA256_MAX_LANES], const uint8_t *const blocks[SHA256_MAX_LANES])
+{
+  uint32_t state[SHA256_STATE_WORDS];
+  size_t i, l;
+
+  for (l = 0; l < SHA256_MAX_LANES; l++)
+  {
+    for (i = 0; i < SHA256_STATE_WORDS; i++)
+      state[i] = h[i][l];
+    hashsig_sha256_compress(state, blocks[l], 1);
+    for (i = 0; i < SHA256_STATE_WORDS; i++)
+      h[i][l] = state[i];
+  }
+}
+
+void hashsig_sha256_compress_x8 (uint32_t h[SHA256_STATE_WORDS][SHA256_MAX_LANES], const uint8_t *const blocks[SHA256_MAX_LANES])
+{
+#ifdef SHA256_MULTI_X86
+  /* SHA-NI beats eight lane AVX2 by about a factor of two. The hash function backend then hashes one lane at a time anyway, but hashsig_sha256_stream always comes here. */
+  if (hashsig_sha256_features & HASHSIG_CPU_SHA)
+  {
+    hashsig_sha256_compress_x8_serial(h, blocks);
+    return;
+  }
+  if (hashsig_sha256_features & HASHSIG_CPU_AVX2)
+  {
+    HASHSIG_STATS_PERMUTATIONS(SHA256_MAX_LANES);
+    hashsig_sha256_compress_x8_avx2(h, blocks);
+    return;
+  }
+#endif
+  HASHSIG_STATS_PERMUTATIONS(SHA256_MAX_LANES);
+  hashsig_sha256_compress_x8_portable(h, blocks);
+}
+
+/* Same as hashsig_sha256_hash, for eight messages of equal length. Since lengths are equal, all lanes share the control flow of hashsig_sha256_update and hashsig_sha256_final. */
+void hashsig_sha256_hash_x8 (sha256_ctx_t *prepared, uint8_t *out[8], const uint8_t *const msg[8], size_t msg_len)
+{
+  uint32_t h[SHA256_STATE_WORDS][SHA256_MAX_LANES];
+  uint8_t b[SHA256_MAX_LANES][SHA256_BLOCK_BYTES];
+  uint8_t hash[SHA256_HASH_BYTES];
+  const uint8_t *blkPtr[SHA256_MAX_LANES];
+  uint64_t len = prepared->len + msg_len;
+  size_t bCnt = prepared->bCnt;
+  size_t done = 0;
+  size_t i, l, n;
+
+  assert(bCnt < SHA256_BLOCK_BYTES); /* catch uninitialized context */
+
+  /* Every lane starts from the prepared context. */
+  for (i = 0; i < SHA256_STATE_WORDS; i++)
+    for (l = 0; l < SHA256_MAX_LANES; l++)
+      h[i][l] = prepared->h[i];
+  for (l = 0; l < SHA256_MAX_LANES; l++)
+    memcpy(b[l], prepared->b, bCnt);
+
+  /* Finish up any buffered message data. */
+  if (bCnt && bCnt + msg_len >= SHA256_BLOCK_BYTES)
+  {
+    n = SHA256_BLOCK_BYTES - bCnt;
+    for (l = 0; l < SHA256_MAX_LANES; l++)
+    {
+      memcpy(b[l] + bCnt, msg[l], n);
+      blkPtr[l] = b[l];
+    }
+    hashsig_sha256_compress_x8(h, blkPtr);
+    done += n;
+    bCnt = 0;
+  }
+
+  /* Process full blocks directly from the messages. */
+  while (bCnt == 0 && msg_len - done >= SHA256_BLOCK_BYTES)
+  {
+    for (l = 0; l < SHA256_MAX_LANES; l++)
+      blkPtr[l] = msg[l] + done;
+    hashsig_sha256_compress_x8(h, blkPtr);
+    done += SHA256_BLOCK_BYTES;
+  }
+
+  /* Buffer the rest and pad with a one bit, zeros and the message length in bits. */
+  n = msg_len - done;
+  for (l = 0; l < SHA256_MAX_LANES; l++)
+  {
+    memcpy(b[l] + bCnt, msg[l] + done, n);
+    b[l][bCnt + n] = 0x80;
+    memset(b[l] + bCnt + n + 1, 0, SHA256_BLOCK_BYTES - bCnt - n - 1);
+    blkPtr[l] = b[l];
+  }
+  bCnt += n + 1;
+  if (bCnt > SHA256_BLOCK_BYTES - 8)
+  {
+    hashsig_sha256_compress_x8(h, blkPtr);
+    for (l = 0; l < SHA256_MAX_LANES; l++)
+      memset(b[l], 0, SHA256_BLOCK_BYTES);
+  }
+  for (l = 0; l < SHA256_MAX_LANES; l++)
+    hashsig_store_be64(b[l] + SHA256_BLOCK_BYTES - 8, len * 8);
+  hashsig_sha256_compress_x8(h, blkPtr);
+
+  /* Output the hash of each lane. */
+  for (l = 0; l < SHA256_MAX_LANES; l++)
+  {
+    for (i = 0; i < SHA256_STATE_WORDS; i++)
+      hashsig_store_be32(hash + i * 4, h[i][l]);
+    memcpy(out[l], hash, prepared->hashLen);
+  }
+}
+
+/* The key and nonce are absorbed and padded to a full block. Output is then generated in counter mode, eight blocks at a time. */
+void hashsig_sha256_stream (sha256_ctx_t *ctx, uint8_t *out, size_t len, const uint8_t *key, size_t key_len, const uint8_t *nonce, size_t nonce_len)
+{
+  static const uint8_t key_separator[8] = { 'H', 'A', 'S', 'H', 'S', 'I', 'G', 'K' };
+  static const uint8_t nonce_separator[8] = { 'H', 'A', 'S', 'H', 'S', 'I', 'G', 'N' };
+  static const uint8_t zeros[SHA256_BLOCK_BYTES] = { 0 };
+  uint32_t h[SHA256_STATE_WORDS][SHA256_MAX_LANES];
+  uint8_t b[SHA256_MAX_LANES][SHA256_BLOCK_BYTES];
+  uint8_t hash[SHA256_HASH_BYTES];
+  uint8_t len_buf[8];
+  const uint8_t *blkPtr[SHA256_MAX_LANES];
+  uint64_t counter = 0;
+  size_t i, l, n;
+
+  assert(key != NULL);
+
+  hashsig_sha256_init(ctx);
+  hashsig_store_le64(len_buf, key_len);
+  hashsig_sha256_update(ctx, key_separator, sizeof(key_separator));
+  hashsig_sha256_update(ctx, len_buf, sizeof(len_buf));
+  hashsig_sha256_update(ctx, key, key_len);
+  hashsig_sha256_update(ctx, key_separator, sizeof(key_separator));
+  hashsig_store_le64(len_buf, nonce_len);
+  hashsig_sha256_update(ctx, nonce_separator, sizeof(nonce_separator));
+  hashsig_sha256_update(ctx, len_buf, sizeof(len_buf));
+  if (nonce_len)
+    hashsig_sha256_update(ctx, nonce, nonce_len);
+  hashsig_sha256_update(ctx, nonce_separator, sizeof(nonce_separator));
+  if (ctx->bCnt)
+    hashsig_sha256_update(ctx, zeros, SHA256_BLOCK_BYTES - ctx->bCnt);
+
+  /* Counter blocks only differ in their first eight bytes. */
+  for (l = 0; l < SHA256_MAX_LANES; l++)
+  {
+    memset(b[l], 0, SHA256_BLOCK_BYTES);
+    b[l][8] = 0x80;
+    hashsig_store_be64(b[l] + SHA256_BLOCK_BYTES - 8, (ctx->len + 8) * 8);
+    blkPtr[l] = b[l];
+  }
+
+  while (len)
+  {
+    for (i = 0; i < SHA256_STATE_WORDS; i++)
+      for (l = 0; l < SHA256_MAX_LANES; l++)
+        h[i][l] = ctx->h[i];
+    for (l = 0; l < SHA256_MAX_LANES; l++)
+      hashsig_store_le64(b[l], counter++);
+    hashsig_sha256_compress_x8(h, blkPtr);
+
+    for (l = 0; l < SHA256_MAX_LANES && len; l++)
+    {
+      for (i = 0; i < SHA256_STATE_WORDS; i++)
+        hashsig_store_be32(hash + i * 4, h[i][l]);
+      n = len < SHA256_HASH_BYTES ? len : SHA256_HASH_BYTES;
+      memcpy(out, hash, n);
+      out += n;
+      len -= n;
+    }
+  }
+}
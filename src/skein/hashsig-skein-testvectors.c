@@ -45,6 +45,43 @@ void dump_hex (const uint8_t *buf, const size_t len)
   printf("\n");
 }
 
+/* Compare multi-lane hashing against hashsig_skein1024_hash. */
+int check_multi (const size_t lanes, const size_t out_len, const size_t msg_len)
+{
+  static const uint8_t nonce[3] = { 0x01, 0x02, 0x03 };
+  uint8_t msg[8][300];
+  uint8_t hash[8][200];
+  uint8_t expected[200];
+  uint8_t *out[8];
+  const uint8_t *in[8];
+  skein1024_ctx_t prepared;
+  size_t i, l;
+
+  hashsig_skein1024_prepare_hash(&prepared, out_len, nonce, sizeof(nonce));
+
+  for (l = 0; l < lanes; l++)
+  {
+    for (i = 0; i < msg_len; i++)
+      msg[l][i] = (uint8_t)(l * 31 + i);
+    out[l] = hash[l];
+    in[l] = msg[l];
+  }
+
+  if (lanes == 4)
+    hashsig_skein1024_hash_x4(&prepared, out, in, msg_len);
+  else
+    hashsig_skein1024_hash_x8(&prepared, out, in, msg_len);
+
+  for (l = 0; l < lanes; l++)
+  {
+    hashsig_skein1024_hash(&prepared, expected, msg[l], msg_len);
+    if (memcmp(expected, hash[l], out_len))
+      return 1;
+  }
+
+  return 0;
+}
+
 int main (int argc, char *argv[])
 {
 	uint8_t hash[1024/8] = { 0 };
@@ -121,4 +158,18 @@ int main (int argc, char *argv[])
 	/* Output result of first test vector. */
   hashsig_skein1024_full(sizeof(hash) * 8, ctx, hash, blocks);
 	dump_hex(hash, sizeof(hash));
+
+
+  /* Check multi-lane hashing with short, block sized, long messages and long output. */
+  if (!check_multi(4, 32, 0) && !check_multi(4, 32, 32) && !check_multi(4, 32, 128) && !check_multi(4, 200, 300))
+    printf("Successfully compared four lane hashing.\n");
+  else
+    printf("Failure at comparing four lane hashing.\n");
+
+  if (!check_multi(8, 32, 1) && !check_multi(8, 32, 64) && !check_multi(8, 32, 129) && !check_multi(8, 200, 257))
+    printf("Successfully compared eight lane hashing.\n");
+  else
+    printf("Failure at comparing eight lane hashing.\n");
+
+  return 0;
 }
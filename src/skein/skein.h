@@ -72,6 +72,10 @@ typedef struct
 void hashsig_skein1024_prepare_hash (skein1024_ctx_t *ctx, size_t len, const uint8_t *nonce, size_t nonce_len);
 void hashsig_skein1024_hash (skein1024_ctx_t *prepared, uint8_t *out, const uint8_t *msg, size_t msg_len);
 
+/* Same as hashsig_skein1024_hash, but hashes four or eight messages of equal length in parallel. */
+void hashsig_skein1024_hash_x4 (skein1024_ctx_t *prepared, uint8_t *out[4], const uint8_t *const msg[4], size_t msg_len);
+void hashsig_skein1024_hash_x8 (skein1024_ctx_t *prepared, uint8_t *out[8], const uint8_t *const msg[8], size_t msg_len);
+
 void hashsig_skein1024_sighash (uint8_t *out, size_t len, const uint8_t *pub, size_t pub_len, const uint8_t *msg, size_t msg_len);
 
 /* After this call secret state will be left in the context. Make sure to use the context for something else after use. */
@@ -0,0 +1,282 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/****************************************************************************
+ *
+ * Multi-lane Skein1024 for hashing several messages of equal length at once.
+ *
+ * Threefish-1024 is computed on vectors holding one word of each lane. On
+ * x86-64, variants for AVX2 and AVX-512 are selected at runtime.
+ *
+ ****************************************************************************/
+
+#include <string.h>
+#include <assert.h>
+#include "skein_internal.h"
+#include "util.h"
+
+/* Definitions used in the Skein1024 block function. */
+#define RCNT                  (SKEIN1024_ROUNDS_TOTAL / 8)
+#define WCNT                  (SKEIN1024_STATE_WORDS)
+#define SKEIN_MULTI_MAX_LANES (8)
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define SKEIN_MULTI_X86
+#endif
+
+typedef uint64_t skein_u64x4_t __attribute__ ((vector_size (32)));
+typedef uint64_t skein_u64x8_t __attribute__ ((vector_size (64)));
+
+typedef void (*skein1024_multi_block_fn) (uint64_t X[SKEIN1024_STATE_WORDS][SKEIN_MULTI_MAX_LANES], uint64_t T[SKEIN_MODIFIER_WORDS], const uint8_t *blkPtr[], size_t blkCnt, size_t byteCntAdd);
+
+#define Round1024(p0,p1,p2,p3,p4,p5,p6,p7,p8,p9,pA,pB,pC,pD,pE,pF,ROT,rNum) \
+          X##p0 += X##p1; X##p1 = RotL_64(X##p1,ROT##_0); X##p1 ^= X##p0;   \
+          X##p2 += X##p3; X##p3 = RotL_64(X##p3,ROT##_1); X##p3 ^= X##p2;   \
+          X##p4 += X##p5; X##p5 = RotL_64(X##p5,ROT##_2); X##p5 ^= X##p4;   \
+          X##p6 += X##p7; X##p7 = RotL_64(X##p7,ROT##_3); X##p7 ^= X##p6;   \
+          X##p8 += X##p9; X##p9 = RotL_64(X##p9,ROT##_4); X##p9 ^= X##p8;   \
+          X##pA += X##pB; X##pB = RotL_64(X##pB,ROT##_5); X##pB ^= X##pA;   \
+          X##pC += X##pD; X##pD = RotL_64(X##pD,ROT##_6); X##pD ^= X##pC;   \
+          X##pE += X##pF; X##pF = RotL_64(X##pF,ROT##_7); X##pF ^= X##pE;   \
+
+#define R1024(p0,p1,p2,p3,p4,p5,p6,p7,p8,p9,pA,pB,pC,pD,pE,pF,ROT,rn) \
+    Round1024(p0,p1,p2,p3,p4,p5,p6,p7,p8,p9,pA,pB,pC,pD,pE,pF,ROT,rn)
+
+/* Inject the key schedule value. The tweak is the same for all lanes. */
+#define I1024(R)                                                      \
+    X00   += ks[r+(R)+ 0];                                            \
+    X01   += ks[r+(R)+ 1];                                            \
+    X02   += ks[r+(R)+ 2];                                            \
+    X03   += ks[r+(R)+ 3];                                            \
+    X04   += ks[r+(R)+ 4];                                            \
+    X05   += ks[r+(R)+ 5];                                            \
+    X06   += ks[r+(R)+ 6];                                            \
+    X07   += ks[r+(R)+ 7];                                            \
+    X08   += ks[r+(R)+ 8];                                            \
+    X09   += ks[r+(R)+ 9];                                            \
+    X10   += ks[r+(R)+10];                                            \
+    X11   += ks[r+(R)+11];                                            \
+    X12   += ks[r+(R)+12];                                            \
+    X13   += ks[r+(R)+13] + ts[r+(R)+0];                              \
+    X14   += ks[r+(R)+14] + ts[r+(R)+1];                              \
+    X15   += ks[r+(R)+15] + (uint64_t)(r+(R));                        \
+    ks[r  +       (R)+16] = ks[r+(R)-1];  /* rotate key schedule */   \
+    ts[r  +       (R)+ 2] = ts[r+(R)-1];
+
+#define R1024_8_rounds(R)                                                         \
+        R1024(00,01,02,03,04,05,06,07,08,09,10,11,12,13,14,15,R1024_0,8*(R) + 1); \
+        R1024(00,09,02,13,06,11,04,15,10,07,12,03,14,05,08,01,R1024_1,8*(R) + 2); \
+        R1024(00,07,02,05,04,03,06,01,12,15,14,13,08,11,10,09,R1024_2,8*(R) + 3); \
+        R1024(00,15,02,11,06,13,04,09,14,01,08,05,10,03,12,07,R1024_3,8*(R) + 4); \
+        I1024(2*(R));                                                             \
+        R1024(00,01,02,03,04,05,06,07,08,09,10,11,12,13,14,15,R1024_4,8*(R) + 5); \
+        R1024(00,09,02,13,06,11,04,15,10,07,12,03,14,05,08,01,R1024_5,8*(R) + 6); \
+        R1024(00,07,02,05,04,03,06,01,12,15,14,13,08,11,10,09,R1024_6,8*(R) + 7); \
+        R1024(00,15,02,11,06,13,04,09,14,01,08,05,10,03,12,07,R1024_7,8*(R) + 8); \
+        I1024(2*(R)+1);
+
+/* Portable block functions. */
+#define SKEIN_MULTI_VEC skein_u64x4_t
+#define SKEIN_MULTI_LANES 4
+#define SKEIN_MULTI_NAME hashsig_skein1024_process_blocks_x4
+#include "skein_multi.macros"
+#undef SKEIN_MULTI_VEC
+#undef SKEIN_MULTI_LANES
+#undef SKEIN_MULTI_NAME
+
+#define SKEIN_MULTI_VEC skein_u64x8_t
+#define SKEIN_MULTI_LANES 8
+#define SKEIN_MULTI_NAME hashsig_skein1024_process_blocks_x8
+#include "skein_multi.macros"
+#undef SKEIN_MULTI_VEC
+#undef SKEIN_MULTI_LANES
+#undef SKEIN_MULTI_NAME
+
+#ifdef SKEIN_MULTI_X86
+/* AVX2 block functions. A 256 bit register holds one word of four lanes. */
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#define SKEIN_MULTI_VEC skein_u64x4_t
+#define SKEIN_MULTI_LANES 4
+#define SKEIN_MULTI_NAME hashsig_skein1024_process_blocks_x4_avx2
+#include "skein_multi.macros"
+#undef SKEIN_MULTI_VEC
+#undef SKEIN_MULTI_LANES
+#undef SKEIN_MULTI_NAME
+
+#define SKEIN_MULTI_VEC skein_u64x8_t
+#define SKEIN_MULTI_LANES 8
+#define SKEIN_MULTI_NAME hashsig_skein1024_process_blocks_x8_avx2
+#include "skein_multi.macros"
+#undef SKEIN_MULTI_VEC
+#undef SKEIN_MULTI_LANES
+#undef SKEIN_MULTI_NAME
+#pragma GCC pop_options
+
+/* AVX-512 block function. Rotations map to single vprolq instructions. */
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#define SKEIN_MULTI_VEC skein_u64x8_t
+#define SKEIN_MULTI_LANES 8
+#define SKEIN_MULTI_NAME hashsig_skein1024_process_blocks_x8_avx512
+#include "skein_multi.macros"
+#undef SKEIN_MULTI_VEC
+#undef SKEIN_MULTI_LANES
+#undef SKEIN_MULTI_NAME
+#pragma GCC pop_options
+#endif
+
+/* Same as hashsig_skein1024_hash, for several messages of equal length. Since lengths are equal, all lanes share the control flow of hashsig_skein1024_update and hashsig_skein1024_final. */
+static void hashsig_skein1024_hash_multi (skein1024_multi_block_fn process_blocks, const size_t lanes, const skein1024_ctx_t *prepared, uint8_t *out[], const uint8_t *const msg[], size_t msg_len)
+{
+  uint64_t X[SKEIN1024_STATE_WORDS][SKEIN_MULTI_MAX_LANES];
+  uint64_t K[SKEIN1024_STATE_WORDS][SKEIN_MULTI_MAX_LANES];
+  uint64_t T[SKEIN_MODIFIER_WORDS];
+  uint64_t words[SKEIN1024_STATE_WORDS];
+  uint8_t b[SKEIN_MULTI_MAX_LANES][SKEIN1024_BLOCK_BYTES];
+  const uint8_t *blkPtr[SKEIN_MULTI_MAX_LANES];
+  size_t bCnt = prepared->bCnt;
+  size_t byteCnt, done = 0;
+  size_t i, l, n;
+
+  assert(lanes <= SKEIN_MULTI_MAX_LANES);
+  assert(bCnt <= SKEIN1024_BLOCK_BYTES); /* catch uninitialized context */
+
+  /* Every lane starts from the prepared context. */
+  T[0] = prepared->T[0];
+  T[1] = prepared->T[1];
+  for (i = 0; i < SKEIN1024_STATE_WORDS; i++)
+    for (l = 0; l < lanes; l++)
+      X[i][l] = prepared->X[i];
+  for (l = 0; l < lanes; l++)
+    memcpy(b[l], prepared->b, bCnt);
+
+  /* Process full blocks, if any. */
+  if (msg_len + bCnt > SKEIN1024_BLOCK_BYTES)
+  {
+    /* Finish up any buffered message data. */
+    if (bCnt)
+    {
+      n = SKEIN1024_BLOCK_BYTES - bCnt;
+      for (l = 0; l < lanes; l++)
+      {
+        memcpy(b[l] + bCnt, msg[l], n);
+        blkPtr[l] = b[l];
+      }
+      process_blocks(X, T, blkPtr, 1, SKEIN1024_BLOCK_BYTES);
+      msg_len -= n;
+      done += n;
+      bCnt = 0;
+    }
+
+    /* Process remaining full blocks directly from the messages, keeping the last one for finalization. */
+    if (msg_len > SKEIN1024_BLOCK_BYTES)
+    {
+      n = (msg_len - 1) / SKEIN1024_BLOCK_BYTES;
+      for (l = 0; l < lanes; l++)
+        blkPtr[l] = msg[l] + done;
+      process_blocks(X, T, blkPtr, n, SKEIN1024_BLOCK_BYTES);
+      msg_len -= n * SKEIN1024_BLOCK_BYTES;
+      done += n * SKEIN1024_BLOCK_BYTES;
+    }
+  }
+
+  /* Buffer and zero pad the final block. */
+  for (l = 0; l < lanes; l++)
+  {
+    memcpy(b[l] + bCnt, msg[l] + done, msg_len);
+    memset(b[l] + bCnt + msg_len, 0, SKEIN1024_BLOCK_BYTES - bCnt - msg_len);
+    blkPtr[l] = b[l];
+  }
+  bCnt += msg_len;
+
+  /* Process the final block. */
+  T[1] |= SKEIN_T1_FLAG_FINAL;
+  process_blocks(X, T, blkPtr, 1, bCnt);
+
+  /* Run Threefish in "counter mode" to generate output. */
+  byteCnt = (prepared->hashBitLen + 7) >> 3;
+  memcpy(K, X, sizeof(K));
+  for (i = 0; i * SKEIN1024_BLOCK_BYTES < byteCnt; i++)
+  {
+    /* Build the counter blocks. */
+    for (l = 0; l < lanes; l++)
+    {
+      memset(b[l], 0, SKEIN1024_BLOCK_BYTES);
+      hashsig_store_le64(b[l], i);
+      blkPtr[l] = b[l];
+    }
+    T[0] = 0;
+    T[1] = SKEIN_T1_FLAG_FIRST | SKEIN_T1_BLK_TYPE_OUT_FINAL;
+    process_blocks(X, T, blkPtr, 1, sizeof(uint64_t));
+
+    /* Output the counter mode bytes of each lane. */
+    n = byteCnt - i * SKEIN1024_BLOCK_BYTES;
+    if (n >= SKEIN1024_BLOCK_BYTES)
+      n = SKEIN1024_BLOCK_BYTES;
+    for (l = 0; l < lanes; l++)
+    {
+      for (done = 0; done < SKEIN1024_STATE_WORDS; done++)
+        words[done] = X[done][l];
+      Skein_Put64_LSB_First(out[l] + i * SKEIN1024_BLOCK_BYTES, words, n);
+    }
+
+    /* Restore the counter mode key for next time. */
+    memcpy(X, K, sizeof(X));
+  }
+}
+
+void hashsig_skein1024_hash_x4 (skein1024_ctx_t *prepared, uint8_t *out[4], const uint8_t *const msg[4], size_t msg_len)
+{
+#ifdef SKEIN_MULTI_X86
+  if (hashsig_cpu_supports(HASHSIG_CPU_AVX2))
+  {
+    hashsig_skein1024_hash_multi(hashsig_skein1024_process_blocks_x4_avx2, 4, prepared, out, msg, msg_len);
+    return;
+  }
+#endif
+  hashsig_skein1024_hash_multi(hashsig_skein1024_process_blocks_x4, 4, prepared, out, msg, msg_len);
+}
+
+void hashsig_skein1024_hash_x8 (skein1024_ctx_t *prepared, uint8_t *out[8], const uint8_t *const msg[8], size_t msg_len)
+{
+#ifdef SKEIN_MULTI_X86
+  if (hashsig_cpu_supports(HASHSIG_CPU_AVX512F))
+  {
+    hashsig_skein1024_hash_multi(hashsig_skein1024_process_blocks_x8_avx512, 8, prepared, out, msg, msg_len);
+    return;
+  }
+  if (hashsig_cpu_supports(HASHSIG_CPU_AVX2))
+  {
+    hashsig_skein1024_hash_multi(hashsig_skein1024_process_blocks_x8_avx2, 8, prepared, out, msg, msg_len);
+    return;
+  }
+#endif
+  hashsig_skein1024_hash_multi(hashsig_skein1024_process_blocks_x8, 8, prepared, out, msg, msg_len);
+}
@@ -0,0 +1,136 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Split-phase signing */
+
+#include <string.h>
+
+#include "hashsig_defs.h"
+#include "hashsig.h"
+#include "ldwm_defs.h"
+#include "lmfs_defs.h"
+#include "util.h"
+
+/* Tree job: type, depth and message hash. Tree result: the same, followed by the root and the signature segment of the tree, with the one-time private key of the selected leaf in place of its signature. */
+#define HASHSIG_TREE_JOB_HEADER 2
+
+typedef char hashsig_tree_job_len_check[(HASHSIG_TREE_JOB_LEN == HASHSIG_TREE_JOB_HEADER + LMFS_HASH_BYTES) ? 1 : -1];
+typedef char hashsig_tree_result_len_check[(HASHSIG_TREE_RESULT_LEN == HASHSIG_TREE_JOB_LEN + LDWM_N + LMFS_SEG_LEN) ? 1 : -1];
+typedef char hashsig_trees_check[(HASHSIG_TREES == LMFS_TREES) ? 1 : -1];
+
+size_t hashsig_sign_split (hashsig_t *ctx, const uint8_t *message, const size_t len, uint8_t *jobs, const size_t jobs_len)
+{
+  uint8_t header[LMFS_SIG_HEADER];
+  uint8_t hash[LMFS_HASH_BYTES];
+  int i;
+
+  hashsig_assert_ctx(ctx);
+
+  if (jobs_len < LMFS_TREES * HASHSIG_TREE_JOB_LEN)
+    return LMFS_TREES * HASHSIG_TREE_JOB_LEN;
+
+  hashsig_lmfs_message(ctx, header, hash, message, len);
+
+  /* List jobs starting at the deepest level, in the order of the segments of the signature. */
+  for (i = LMFS_TREES - 1; i >= 0; i--, jobs += HASHSIG_TREE_JOB_LEN)
+  {
+    jobs[0] = ctx->type;
+    jobs[1] = i;
+    memcpy(jobs + HASHSIG_TREE_JOB_HEADER, hash, LMFS_HASH_BYTES);
+  }
+
+  return 0;
+}
+
+size_t hashsig_sign_tree (hashsig_t *ctx, const uint8_t *job, uint8_t *result, const size_t result_len)
+{
+  uint8_t *segment = result + HASHSIG_TREE_JOB_LEN + LDWM_N;
+
+  hashsig_assert_ctx(ctx);
+
+  if (result_len < HASHSIG_TREE_RESULT_LEN || job[0] != ctx->type || job[1] >= LMFS_TREES)
+    return HASHSIG_TREE_RESULT_LEN;
+
+  memcpy(result, job, HASHSIG_TREE_JOB_LEN);
+  hashsig_lmfs_tree(ctx, job + HASHSIG_TREE_JOB_HEADER, job[1], result + HASHSIG_TREE_JOB_LEN, segment + LDWM_N + LDWM_SIG_LEN, segment + LDWM_N, segment, NULL);
+
+  return 0;
+}
+
+size_t hashsig_sign_assemble (hashsig_t *ctx, const uint8_t *results, const size_t count, uint8_t *out, const size_t out_len)
+{
+  const uint8_t *by_depth[LMFS_TREES] = { NULL };
+  const uint8_t *hash, *last;
+  uint8_t *buf = out + LMFS_SIG_HEADER;
+  uint8_t root[LDWM_N];
+  size_t i;
+  int depth;
+
+  hashsig_assert_ctx(ctx);
+
+  if (out_len < LMFS_SIG_LEN)
+    return LMFS_SIG_LEN;
+
+  /* Results may come in any order, but there has to be exactly one per tree, all for the same message. */
+  if (count != LMFS_TREES)
+    return 1;
+  for (i = 0; i < count; i++)
+  {
+    const uint8_t *result = results + i * HASHSIG_TREE_RESULT_LEN;
+
+    if (result[0] != ctx->type || result[1] >= LMFS_TREES || by_depth[result[1]] != NULL || memcmp(result + HASHSIG_TREE_JOB_HEADER, results + HASHSIG_TREE_JOB_HEADER, LMFS_HASH_BYTES))
+      return 1;
+    by_depth[result[1]] = result;
+  }
+
+  hash = results + HASHSIG_TREE_JOB_HEADER;
+
+  /* Roots are signed by one-time keys, so check each against the leaf public key and Merkle tree path of its tree before signing anything. */
+  for (depth = 0; depth < LMFS_TREES; depth++)
+  {
+    ctx->backend->prepare_hash(ctx->hash_ctx, LDWM_N, hash, depth);
+    hashsig_lmfs_path_root(ctx, by_depth[depth] + HASHSIG_TREE_JOB_LEN + LDWM_N, hash, root, depth);
+    if (memcmp(root, by_depth[depth] + HASHSIG_TREE_JOB_LEN, LDWM_N))
+      return 1;
+  }
+
+  last = hash;
+  memcpy(out, &ctx->type, LMFS_SIG_HEADER);
+
+  /* Sign message hash or root of lower tree, starting at the deepest level. This turns the private keys into signatures. */
+  for (depth = LMFS_TREES - 1; depth >= 0; depth--, buf += LMFS_SEG_LEN)
+  {
+    memcpy(buf, by_depth[depth] + HASHSIG_TREE_JOB_LEN + LDWM_N, LMFS_SEG_LEN);
+    ctx->backend->prepare_hash(ctx->hash_ctx, LDWM_N, hash, depth);
+    hashsig_ldwm_sign(ctx, buf + LDWM_N, last, LDWM_N, 1);
+    last = by_depth[depth] + HASHSIG_TREE_JOB_LEN;
+  }
+
+  return 0;
+}
@@ -0,0 +1,177 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#if defined(HASHSIG_STATS) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+#include "hashsig_defs.h"
+#include "hashsig.h"
+#include "stats.h"
+
+/* Hot path statistics */
+
+static const char *const phase_names[HASHSIG_PHASES] = { "message", "prf", "chains", "leaves", "merkle", "sign" };
+
+#ifdef HASHSIG_STATS
+__thread uint64_t hashsig_stats_permutations;
+
+void hashsig_stats_begin (hashsig_stats_mark_t *mark)
+{
+  struct timespec ts;
+
+  mark->permutations = hashsig_stats_permutations;
+#if defined(__x86_64__) || defined(__i386__)
+  mark->cycles = __rdtsc();
+#else
+  mark->cycles = 0;
+#endif
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  mark->ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void hashsig_stats_end (hashsig_t *ctx, const hashsig_stats_mark_t *mark, const int phase, const uint64_t calls)
+{
+  hashsig_phase_stats_t *stats = &ctx->stats.phase[phase];
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  stats->ns += (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec - mark->ns;
+#if defined(__x86_64__) || defined(__i386__)
+  stats->cycles += __rdtsc() - mark->cycles;
+#endif
+  stats->permutations += hashsig_stats_permutations - mark->permutations;
+  stats->calls += calls;
+}
+
+uint64_t hashsig_stats_sum (const uint8_t *counts, const size_t n)
+{
+  uint64_t sum = 0;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    sum += counts[i];
+  return sum;
+}
+
+/* Merge statistics of a context used by a parallel task. */
+void hashsig_stats_add (hashsig_stats_t *stats, const hashsig_stats_t *add)
+{
+  int i;
+
+  stats->signatures += add->signatures;
+  stats->trees += add->trees;
+  for (i = 0; i < HASHSIG_PHASES; i++)
+  {
+    stats->phase[i].calls += add->phase[i].calls;
+    stats->phase[i].permutations += add->phase[i].permutations;
+    stats->phase[i].ns += add->phase[i].ns;
+    stats->phase[i].cycles += add->phase[i].cycles;
+  }
+}
+#endif
+
+int hashsig_get_stats (const hashsig_t *ctx, hashsig_stats_t *stats)
+{
+#ifdef HASHSIG_STATS
+  memcpy(stats, &ctx->stats, sizeof(hashsig_stats_t));
+  return 0;
+#else
+  memset(stats, 0, sizeof(hashsig_stats_t));
+  return 1;
+#endif
+}
+
+/* Append str to buf as far as it fits, keeping it zero terminated, and return the length the text would have had. */
+static size_t append (char *buf, const size_t len, const size_t pos, const char *str)
+{
+  size_t n = strlen(str);
+
+  if (pos + n < len)
+    memcpy(buf + pos, str, n + 1);
+  else if (pos + 1 < len)
+  {
+    memcpy(buf + pos, str, len - pos - 1);
+    buf[len - 1] = 0;
+  }
+
+  return pos + n;
+}
+
+/* Append a counter with its HELP and TYPE lines, either one value or one per phase. */
+static size_t append_counter (char *buf, const size_t len, size_t pos, const char *name, const char *help, const hashsig_stats_t *stats, const uint64_t value, const size_t offset)
+{
+  char line[256];
+  uint64_t v;
+  int i;
+
+  snprintf(line, sizeof(line), "# HELP hashsig_%s %s\n# TYPE hashsig_%s counter\n", name, help, name);
+  pos = append(buf, len, pos, line);
+
+  if (stats == NULL)
+  {
+    snprintf(line, sizeof(line), "hashsig_%s %llu\n", name, (unsigned long long)value);
+    return append(buf, len, pos, line);
+  }
+
+  for (i = 0; i < HASHSIG_PHASES; i++)
+  {
+    memcpy(&v, (const uint8_t *)&stats->phase[i] + offset, sizeof(v));
+    if (offset == offsetof(hashsig_phase_stats_t, ns))
+      snprintf(line, sizeof(line), "hashsig_%s{phase=\"%s\"} %llu.%09llu\n", name, phase_names[i], (unsigned long long)(v / 1000000000), (unsigned long long)(v % 1000000000));
+    else
+      snprintf(line, sizeof(line), "hashsig_%s{phase=\"%s\"} %llu\n", name, phase_names[i], (unsigned long long)v);
+    pos = append(buf, len, pos, line);
+  }
+
+  return pos;
+}
+
+size_t hashsig_stats2prometheus (const hashsig_stats_t *stats, char *buf, const size_t len)
+{
+  size_t pos = 0;
+
+  pos = append_counter(buf, len, pos, "signatures_total", "Number of signatures created.", NULL, stats->signatures, 0);
+  pos = append_counter(buf, len, pos, "trees_total", "Number of Merkle trees calculated.", NULL, stats->trees, 0);
+  pos = append_counter(buf, len, pos, "phase_calls_total", "Hash function calls per phase, counting each hash chain step.", stats, 0, offsetof(hashsig_phase_stats_t, calls));
+  pos = append_counter(buf, len, pos, "phase_permutations_total", "Keccak permutations or SHA-256 compression function calls per phase.", stats, 0, offsetof(hashsig_phase_stats_t, permutations));
+  pos = append_counter(buf, len, pos, "phase_cycles_total", "Time stamp counter ticks per phase.", stats, 0, offsetof(hashsig_phase_stats_t, cycles));
+  pos = append_counter(buf, len, pos, "phase_seconds_total", "Wall clock time per phase.", stats, 0, offsetof(hashsig_phase_stats_t, ns));
+
+  if (pos + 1 > len)
+    return pos + 1;
+  return 0;
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hashsig.h"
+
+/* Hot path statistics, only compiled in if HASHSIG_STATS is defined. Otherwise all macros expand to nothing, including their arguments.
+ *
+ * Hash functions count their permutations or compression function calls with HASHSIG_STATS_PERMUTATIONS in a thread local counter. A phase is measured by declaring HASHSIG_STATS_MARK in the function, starting it with HASHSIG_STATS_BEGIN and ending it with HASHSIG_STATS_END, which adds the elapsed time, the number of hash function calls given by the caller and the permutations counted meanwhile to the context. */
+
+#ifdef HASHSIG_STATS
+
+typedef struct
+{
+  uint64_t ns;
+  uint64_t cycles;
+  uint64_t permutations;
+} hashsig_stats_mark_t;
+
+extern __thread uint64_t hashsig_stats_permutations;
+
+void hashsig_stats_begin (hashsig_stats_mark_t *mark);
+void hashsig_stats_end (hashsig_t *ctx, const hashsig_stats_mark_t *mark, const int phase, const uint64_t calls);
+uint64_t hashsig_stats_sum (const uint8_t *counts, const size_t n);
+void hashsig_stats_add (hashsig_stats_t *stats, const hashsig_stats_t *add);
+
+#define HASHSIG_STATS_PERMUTATIONS(n) (hashsig_stats_permutations += (n))
+#define HASHSIG_STATS_MARK hashsig_stats_mark_t hashsig_stats_mark;
+#define HASHSIG_STATS_BEGIN() hashsig_stats_begin(&hashsig_stats_mark)
+#define HASHSIG_STATS_END(ctx, phase, calls) hashsig_stats_end(ctx, &hashsig_stats_mark, phase, calls)
+#define HASHSIG_STATS_COUNT(field) (field++)
+#define HASHSIG_STATS_RESET(ctx) memset(&(ctx)->stats, 0, sizeof(hashsig_stats_t))
+#define HASHSIG_STATS_ADD(ctx, from) hashsig_stats_add(&(ctx)->stats, &(from)->stats)
+
+#else
+
+#define HASHSIG_STATS_PERMUTATIONS(n) ((void)0)
+#define HASHSIG_STATS_MARK
+#define HASHSIG_STATS_BEGIN() ((void)0)
+#define HASHSIG_STATS_END(ctx, phase, calls) ((void)0)
+#define HASHSIG_STATS_COUNT(field) ((void)0)
+#define HASHSIG_STATS_RESET(ctx) ((void)0)
+#define HASHSIG_STATS_ADD(ctx, from) ((void)0)
+
+#endif
+
+#endif /* STATS_H */
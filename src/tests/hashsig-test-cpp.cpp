@@ -0,0 +1,155 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+#include "hashsig.hpp"
+
+/* Test program for the C++ interface, comparing Key, Signer, Verifier and co_sign against the C functions. */
+
+static int failures = 0;
+
+static void report (const bool ok, const char *what)
+{
+  if (ok)
+    std::printf("Successfully %s.\n", what);
+  else
+  {
+    std::printf("Failure at %s.\n", what);
+    failures++;
+  }
+}
+
+static bool same (hashsig::Bytes a, const std::vector<uint8_t> &b)
+{
+  return a.size() == b.size() && std::memcmp(a.data(), b.data(), b.size()) == 0;
+}
+
+#ifdef HASHSIG_COROUTINES
+/* Coroutine started eagerly and not awaited, main waits for done instead. */
+struct Task
+{
+  struct promise_type
+  {
+    Task get_return_object () { return {}; }
+    std::suspend_never initial_suspend () { return {}; }
+    std::suspend_never final_suspend () noexcept { return {}; }
+    void return_void () {}
+    void unhandled_exception () { std::terminate(); }
+  };
+};
+
+static Task co_test (hashsig::Signer &signer, const hashsig::Verifier &verifier, hashsig::Bytes message, const std::vector<uint8_t> &ref, std::atomic<bool> &done)
+{
+  hashsig::Expected<hashsig::Signature> sig = co_await hashsig::co_sign(signer, message);
+
+  report(sig && same(sig->bytes(), ref), "signed with co_sign");
+  report(sig && co_await hashsig::co_verify(verifier, message, sig->bytes()), "verified with co_verify");
+  done = true;
+}
+#endif
+
+static void test_type (const uint32_t type)
+{
+  std::byte priv[64], message[1000];
+  std::size_t priv_len = hashsig_private_key_length_type(type), i;
+  hashsig_t *ctx;
+  hashsig_pub_t *pub;
+  std::vector<uint8_t> pub_ref, sig_ref;
+
+  std::printf("Type %02lx\n", (unsigned long)type);
+
+  for (i = 0; i < sizeof(priv); i++)
+    priv[i] = std::byte(i * 7 + type);
+  for (i = 0; i < sizeof(message); i++)
+    message[i] = std::byte(i * 13);
+
+  /* Reference public key and signature from the C interface. */
+  ctx = hashsig_create_context_type(type, reinterpret_cast<uint8_t *>(priv), priv_len, NULL);
+  pub = hashsig_get_public_key(ctx);
+  pub_ref.resize(hashsig_public_key_length(ctx));
+  hashsig_pub2buf(pub, pub_ref.data(), pub_ref.size());
+  sig_ref.resize(hashsig_signature_length(ctx));
+  hashsig_sign_into(ctx, reinterpret_cast<uint8_t *>(message), sizeof(message), sig_ref.data(), sig_ref.size());
+  hashsig_free(pub);
+  hashsig_destroy_context(ctx);
+
+  report(!hashsig::Key::create(type, hashsig::Bytes(priv, priv_len - 1)), "rejected a short private key");
+
+  hashsig::Expected<hashsig::Key> key = hashsig::Key::create(type, hashsig::Bytes(priv, priv_len));
+  if (!key)
+  {
+    report(false, "created a key");
+    return;
+  }
+  report(same(key->public_key().bytes(), pub_ref), "derived the public key");
+
+  hashsig::Expected<hashsig::Signer> signer = key->signer();
+  if (!signer)
+  {
+    report(false, "acquired a signer");
+    return;
+  }
+
+  hashsig::Expected<hashsig::Signature> sig = signer->sign(message);
+  report(sig && same(sig->bytes(), sig_ref), "signed with Signer");
+
+  hashsig::Expected<hashsig::Verifier> verifier = hashsig::Verifier::create(key->public_key().bytes());
+  if (!verifier)
+  {
+    report(false, "created a verifier");
+    return;
+  }
+  report(sig && verifier->verify(message, sig->bytes()), "verified with Verifier");
+
+  message[3] ^= std::byte(1);
+  report(sig && !verifier->verify(message, sig->bytes()), "rejected a changed message");
+  message[3] ^= std::byte(1);
+
+#ifdef HASHSIG_COROUTINES
+  std::atomic<bool> done(false);
+
+  co_test(*signer, *verifier, message, sig_ref, done);
+  while (!done)
+    std::this_thread::yield();
+#else
+  report(true, "signed with co_sign");
+  report(true, "verified with co_verify");
+#endif
+}
+
+int main ()
+{
+  report(!hashsig::Key::create(0x07, hashsig::Bytes()), "rejected an unsupported type");
+  test_type(HASHSIG_TYPE_SHA256_T32_B8_M32_N32_W4);
+
+  return failures > 0;
+}
@@ -0,0 +1,239 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashsig.h"
+
+
+/* Test program comparing all ways of signing against hashsig_sign_into and all ways of verifying against hashsig_verify_view. */
+
+#define MESSAGES 3
+
+static const uint32_t types[] = { HASHSIG_TYPE_KECCAK_T32_B8_M32_N32_W4, HASHSIG_TYPE_SHA256_T32_B8_M32_N32_W4, HASHSIG_TYPE_TURBOSHAKE_T32_B8_M32_N32_W4 };
+
+void report (const int ok, const char *what)
+{
+  if (ok)
+    printf("Successfully %s.\n", what);
+  else
+    printf("Failure at %s.\n", what);
+}
+
+typedef struct
+{
+  uint8_t *buf;
+  size_t len;
+  size_t pieces;
+} sink_t;
+
+int sink (void *user, const uint8_t *data, const size_t len)
+{
+  sink_t *s = user;
+
+  memcpy(s->buf + s->len, data, len);
+  s->len += len;
+  s->pieces++;
+  return 0;
+}
+
+/* Make msg, of len bytes, sign below the same top level leaf as other, so batches share more than the top tree. The message hash follows the type and depth of each job. */
+void share_prefix (hashsig_t *ctx, const uint8_t *other, const size_t other_len, uint8_t *msg, const size_t len)
+{
+  uint8_t a[HASHSIG_TREES * HASHSIG_TREE_JOB_LEN], b[HASHSIG_TREES * HASHSIG_TREE_JOB_LEN];
+
+  hashsig_sign_split(ctx, other, other_len, a, sizeof(a));
+  do
+  {
+    msg[0]++;
+    hashsig_sign_split(ctx, msg, len, b, sizeof(b));
+  } while (a[2] != b[2]);
+}
+
+void test_type (const uint32_t type)
+{
+  static const size_t lens[MESSAGES] = { 120, 77, 0 };
+  uint8_t priv[32];
+  uint8_t msg[MESSAGES][120];
+  const uint8_t *msgs[MESSAGES];
+  uint8_t *ref[MESSAGES], *out[MESSAGES];
+  uint8_t pub_buf[64];
+  uint8_t *sig, *buf, *jobs, *results;
+  hashsig_pub_view_t pub, pubs[MESSAGES];
+  hashsig_sig_view_t sigs[MESSAGES];
+  hashsig_sign_state_t *state;
+  hashsig_verifier_t *verifier;
+  hashsig_engine_t *engine;
+  hashsig_pub_t *pub_key;
+  hashsig_t *ctx;
+  sink_t s;
+  int res[MESSAGES + 1];
+  size_t sig_len, len, i, j;
+  int ok;
+
+  printf("Type %02x\n", (unsigned)type);
+
+  for (i = 0; i < sizeof(priv); i++)
+    priv[i] = i;
+  ctx = hashsig_create_context_type(type, priv, sizeof(priv), NULL);
+  sig_len = hashsig_signature_length(ctx);
+  pub_key = hashsig_get_public_key(ctx);
+  hashsig_pub2buf(pub_key, pub_buf, hashsig_public_key_length(ctx));
+  hashsig_pub_view(&pub, pub_buf, hashsig_public_key_length(ctx));
+
+  for (i = 0; i < MESSAGES; i++)
+  {
+    for (j = 0; j < sizeof(msg[i]); j++)
+      msg[i][j] = (uint8_t)(i * 31 + j);
+    msgs[i] = msg[i];
+  }
+  share_prefix(ctx, msg[0], lens[0], msg[1], lens[1]);
+
+  for (i = 0; i < MESSAGES; i++)
+  {
+    ref[i] = calloc(1, sig_len);
+    out[i] = calloc(1, sig_len);
+    hashsig_sign_into(ctx, msgs[i], lens[i], ref[i], sig_len);
+  }
+  sig = calloc(1, sig_len);
+
+  /* Parallel signing. */
+  report(!hashsig_sign_parallel(ctx, msgs[0], lens[0], sig, sig_len, NULL) && !memcmp(sig, ref[0], sig_len), "signed in parallel");
+
+  /* Batch signing, with the first two messages sharing the top two trees. */
+  ok = !hashsig_sign_batch(ctx, msgs, lens, MESSAGES, out, sig_len, NULL);
+  for (i = 0; i < MESSAGES; i++)
+    ok = ok && !memcmp(out[i], ref[i], sig_len);
+  report(ok, "signed a batch");
+
+  /* Signing into a sink, one piece per tree after the header. */
+  s.buf = sig;
+  s.len = s.pieces = 0;
+  memset(sig, 0, sig_len);
+  report(!hashsig_sign_sink(ctx, msgs[0], lens[0], sink, &s) && s.len == sig_len && s.pieces == HASHSIG_TREES + 1 && !memcmp(sig, ref[0], sig_len), "signed into a sink");
+
+  /* Resumable signing, saving and loading the state half way. */
+  state = hashsig_sign_start(ctx, msgs[0], lens[0]);
+  hashsig_sign_continue(ctx, state, HASHSIG_TREES / 2);
+  len = hashsig_sign_state2buf(state, NULL, 0);
+  buf = calloc(1, len);
+  ok = !hashsig_sign_state2buf(state, buf, len);
+  hashsig_free(state);
+  ok = ok && !hashsig_buf2sign_state(ctx, &state, buf, len);
+  if (ok)
+  {
+    ok = !hashsig_sign_continue(ctx, state, 0) && !hashsig_sign_state2sig(state, sig, sig_len) && !memcmp(sig, ref[0], sig_len);
+    hashsig_free(state);
+  }
+  report(ok, "resumed signing from a saved state");
+
+  /* A damaged state is rejected. */
+  buf[len - 1] ^= 1;
+  report(hashsig_buf2sign_state(ctx, &state, buf, len) && state == NULL, "rejected a damaged state");
+  free(buf);
+
+  /* Split-phase signing, assembling the results in reverse order. */
+  jobs = calloc(HASHSIG_TREES, HASHSIG_TREE_JOB_LEN);
+  results = calloc(HASHSIG_TREES, HASHSIG_TREE_RESULT_LEN);
+  ok = !hashsig_sign_split(ctx, msgs[0], lens[0], jobs, HASHSIG_TREES * HASHSIG_TREE_JOB_LEN);
+  for (i = 0; i < HASHSIG_TREES; i++)
+    ok = ok && !hashsig_sign_tree(ctx, jobs + i * HASHSIG_TREE_JOB_LEN, results + (HASHSIG_TREES - 1 - i) * HASHSIG_TREE_RESULT_LEN, HASHSIG_TREE_RESULT_LEN);
+  report(ok && !hashsig_sign_assemble(ctx, results, HASHSIG_TREES, sig, sig_len) && !memcmp(sig, ref[0], sig_len), "assembled split signature");
+
+  /* A damaged result is rejected. */
+  results[HASHSIG_TREE_JOB_LEN] ^= 1;
+  report(hashsig_sign_assemble(ctx, results, HASHSIG_TREES, sig, sig_len) == 1, "rejected a damaged tree result");
+  free(jobs);
+  free(results);
+
+  /* Streaming verification in small pieces. */
+  verifier = hashsig_verifier_create(&pub);
+  for (i = 0; i < lens[0]; i += 7)
+    hashsig_verifier_message(verifier, msgs[0] + i, (lens[0] - i < 7) ? lens[0] - i : 7);
+  for (ok = 0, i = 0; i < sig_len && !ok; i += 13)
+    ok = hashsig_verifier_signature(verifier, ref[0] + i, (sig_len - i < 13) ? sig_len - i : 13);
+  report(!ok && !hashsig_verifier_final(verifier), "verified in small pieces");
+  hashsig_verifier_free(verifier);
+
+  verifier = hashsig_verifier_create(&pub);
+  hashsig_verifier_message(verifier, msgs[1], lens[1]);
+  ok = hashsig_verifier_signature(verifier, ref[0], sig_len);
+  report(ok > 0 || hashsig_verifier_final(verifier) > 0, "failed streaming verification of bad message");
+  hashsig_verifier_free(verifier);
+
+  /* Batch verification, then with the signatures of the first two messages swapped. */
+  for (i = 0; i < MESSAGES; i++)
+  {
+    pubs[i] = pub;
+    hashsig_sig_view(&sigs[i], ref[i], sig_len);
+  }
+  report(!hashsig_verify_batch(pubs, sigs, msgs, lens, MESSAGES, res, NULL) && !res[0] && !res[1] && !res[2], "verified a batch");
+  hashsig_sig_view(&sigs[0], ref[1], sig_len);
+  hashsig_sig_view(&sigs[1], ref[0], sig_len);
+  report(hashsig_verify_batch(pubs, sigs, msgs, lens, MESSAGES, res, NULL) > 0 && res[0] > 0 && res[1] > 0 && !res[2], "failed batch verification of swapped signatures");
+
+  /* Verification engine, with one bad job. */
+  if ((engine = hashsig_engine_create(2, NULL, NULL)) != NULL)
+  {
+    ok = 1;
+    for (i = 0; i < MESSAGES; i++)
+    {
+      hashsig_sig_view(&sigs[i], ref[i], sig_len);
+      ok = ok && !hashsig_engine_submit(engine, &pub, &sigs[i], msgs[i], lens[i], &res[i], NULL);
+    }
+    ok = ok && !hashsig_engine_submit(engine, &pub, &sigs[0], msgs[1], lens[1], &res[MESSAGES], NULL);
+    hashsig_engine_wait(engine);
+    hashsig_engine_destroy(engine);
+    report(ok && !res[0] && !res[1] && !res[2] && res[MESSAGES] > 0, "verified with the engine");
+  }
+  else
+    report(1, "verified with the engine");
+
+  for (i = 0; i < MESSAGES; i++)
+  {
+    free(ref[i]);
+    free(out[i]);
+  }
+  free(sig);
+  hashsig_free(pub_key);
+  hashsig_destroy_context(ctx);
+}
+
+int main (int argc, char *argv[])
+{
+  size_t i;
+
+  for (i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    test_type(types[i]);
+
+  return 0;
+}
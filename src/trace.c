@@ -0,0 +1,167 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hashsig.h"
+#include "trace.h"
+
+/* Chrome trace event recorder */
+
+#ifdef HASHSIG_TRACE
+typedef struct
+{
+  const char *name;
+  uint64_t arg;
+  uint64_t start;
+  uint64_t end;
+  uint32_t tid;
+} hashsig_trace_event_t;
+
+volatile int hashsig_trace_enabled;
+
+static hashsig_trace_event_t *events;
+static size_t capacity;
+static volatile size_t count;
+static volatile size_t writers;
+static uint64_t origin;
+static uint32_t next_tid;
+static __thread uint32_t tid;
+
+uint64_t hashsig_trace_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  /* Never zero, which marks spans started while the recorder was off. */
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec + 1;
+}
+
+void hashsig_trace_span (const char *name, const uint64_t start, const uint64_t arg)
+{
+  const uint64_t end = hashsig_trace_now();
+  size_t i;
+
+  /* Announce the write before checking whether recording is on, so hashsig_trace_stop either sees it and waits, or this sees recording off. */
+  __sync_fetch_and_add(&writers, 1);
+  if (!__sync_fetch_and_or(&hashsig_trace_enabled, 0))
+  {
+    __sync_fetch_and_sub(&writers, 1);
+    return;
+  }
+
+  /* Number threads in the order of their first span. */
+  if (tid == 0)
+    tid = __sync_add_and_fetch(&next_tid, 1);
+
+  /* Spans beyond the capacity are counted, but dropped. */
+  i = __sync_fetch_and_add(&count, 1);
+  if (i < capacity)
+  {
+    events[i].name = name;
+    events[i].arg = arg;
+    events[i].start = start;
+    events[i].end = end;
+    events[i].tid = tid;
+  }
+
+  __sync_fetch_and_sub(&writers, 1);
+}
+#endif
+
+int hashsig_trace_start (const size_t max_events)
+{
+#ifdef HASHSIG_TRACE
+  if (max_events == 0 || __sync_fetch_and_or(&hashsig_trace_enabled, 0))
+    return 1;
+
+  events = calloc(max_events, sizeof(hashsig_trace_event_t));
+  if (events == NULL)
+    return 1;
+
+  capacity = max_events;
+  count = 0;
+  origin = hashsig_trace_now();
+  __sync_bool_compare_and_swap(&hashsig_trace_enabled, 0, 1);
+
+  return 0;
+#else
+  return 1;
+#endif
+}
+
+int hashsig_trace_stop (const char *path)
+{
+#ifdef HASHSIG_TRACE
+  FILE *f;
+  size_t n, i;
+  int ret = 0;
+
+  /* Threads of the library may still be recording spans, wait until they are done with the buffer. */
+  if (!__sync_bool_compare_and_swap(&hashsig_trace_enabled, 1, 0))
+    return 1;
+  while (__sync_fetch_and_or(&writers, 0) > 0)
+    sched_yield();
+  n = (count < capacity) ? count : capacity;
+
+  f = (path != NULL) ? fopen(path, "w") : NULL;
+  if (f != NULL)
+  {
+    fprintf(f, "{\"traceEvents\":[\n");
+    for (i = 0; i < n; i++)
+    {
+      /* Skip spans that were started before the recorder. */
+      if (events[i].start < origin)
+        continue;
+      fprintf(f, "{\"name\":\"%s\",\"cat\":\"hashsig\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"arg\":%llu}},\n",
+              events[i].name, (unsigned long)events[i].tid, (events[i].start - origin) / 1e3, (events[i].end - events[i].start) / 1e3, (unsigned long long)events[i].arg);
+    }
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"libhashsig\"}}\n");
+    fprintf(f, "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%lu}}\n", (unsigned long)(count - n));
+    if (fclose(f))
+      ret = 1;
+  }
+  else
+    ret = 1;
+
+  free(events);
+  events = NULL;
+
+  return ret;
+#else
+  return 1;
+#endif
+}
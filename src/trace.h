@@ -0,0 +1,70 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/* Tracing of signing and verification phases.
+ *
+ * A span is opened with HASHSIG_TRACE_BEGIN(name, arg) and closed with HASHSIG_TRACE_END(name, arg) in the same block. Every span has a USDT probe hashsig:name_start and hashsig:name_end with one integer argument, if HASHSIG_USDT is defined. If HASHSIG_TRACE is defined, spans are also recorded for Chrome trace event JSON while hashsig_trace_start is in effect. Otherwise the macros expand to nothing, including their arguments. Each name can only be used once per block. */
+
+#ifdef HASHSIG_USDT
+#include <sys/sdt.h>
+#define HASHSIG_PROBE(name, arg) DTRACE_PROBE1(hashsig, name, arg)
+#else
+#define HASHSIG_PROBE(name, arg) ((void)0)
+#endif
+
+#ifdef HASHSIG_TRACE
+
+extern volatile int hashsig_trace_enabled;
+
+uint64_t hashsig_trace_now (void);
+void hashsig_trace_span (const char *name, const uint64_t start, const uint64_t arg);
+
+#define HASHSIG_TRACE_BEGIN(name, arg) \
+  HASHSIG_PROBE(name##_start, arg); \
+  const uint64_t hashsig_trace_##name = hashsig_trace_enabled ? hashsig_trace_now() : 0
+#define HASHSIG_TRACE_END(name, arg) \
+  do { \
+    HASHSIG_PROBE(name##_end, arg); \
+    if (hashsig_trace_##name) \
+      hashsig_trace_span(#name, hashsig_trace_##name, arg); \
+  } while (0)
+
+#else
+
+#define HASHSIG_TRACE_BEGIN(name, arg) HASHSIG_PROBE(name##_start, arg)
+#define HASHSIG_TRACE_END(name, arg) HASHSIG_PROBE(name##_end, arg)
+
+#endif
+
+#endif /* TRACE_H */
@@ -35,23 +35,7 @@
 #include "brg_endian.h"
 #include "hashsig_defs.h"
 #include "hashsig.h"
-
-/* Failing calloc. */
-void *hashsig_calloc (size_t nmemb, size_t size)
-{
-  uint8_t *buf = calloc(nmemb, size);
-  if (buf == NULL)
-  {
-    fprintf(stderr, "Failed to allocate memory.");
-    abort();
-  }
-  return buf;
-}
-
-void hashsig_free (void *buf)
-{
-  free(buf);
-}
+#include "util.h"
 
 uint16_t hashsig_load_le16 (const uint8_t *buf)
 {
@@ -110,11 +94,53 @@ void hashsig_store_le64 (uint8_t *buf, uint64_t v)
 #endif
 }
 
+uint32_t hashsig_load_be32 (const uint8_t *buf)
+{
+  return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+void hashsig_store_be32 (uint8_t *buf, uint32_t v)
+{
+  buf[0] = v >> 24;
+  buf[1] = (v >> 16) & 0xff;
+  buf[2] = (v >> 8) & 0xff;
+  buf[3] = v & 0xff;
+}
+
+void hashsig_store_be64 (uint8_t *buf, uint64_t v)
+{
+  hashsig_store_be32(buf, v >> 32);
+  hashsig_store_be32(buf + 4, v & 0xffffffff);
+}
+
 void hashsig_assert_ctx (hashsig_t *ctx)
 {
   assert(ctx != NULL);
   assert(ctx->pub != NULL);
-  assert(ctx->keccak_ctx != NULL);
+  assert(ctx->backend != NULL);
+  assert(ctx->hash_ctx != NULL);
   assert(ctx->priv_scratch != NULL);
   assert(ctx->pub_scratch != NULL);
 }
+
+int hashsig_cpu_supports (const int features)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+
+  if ((features & HASHSIG_CPU_AVX2) && !__builtin_cpu_supports("avx2"))
+    return 0;
+  if ((features & HASHSIG_CPU_AVX512F) && !__builtin_cpu_supports("avx512f"))
+    return 0;
+  if ((features & HASHSIG_CPU_SHA) && !__builtin_cpu_supports("sha"))
+    return 0;
+  if ((features & HASHSIG_CPU_BMI1) && !__builtin_cpu_supports("bmi"))
+    return 0;
+  if ((features & HASHSIG_CPU_BMI2) && !__builtin_cpu_supports("bmi2"))
+    return 0;
+
+  return 1;
+#else
+  return 0;
+#endif
+}
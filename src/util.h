@@ -35,12 +35,28 @@
 #include "hashsig.h"
 
 void *hashsig_calloc (size_t nmemb, size_t size);
+void *hashsig_alloc (const hashsig_allocator_t *allocator, const size_t size, const size_t align);
+void hashsig_dealloc (const hashsig_allocator_t *allocator, void *buf, const size_t size);
+const hashsig_allocator_t *hashsig_current_allocator (void);
 uint16_t hashsig_load_le16 (const uint8_t *buf);
 uint32_t hashsig_load_le32 (const uint8_t *buf);
 uint64_t hashsig_load_le64 (const uint8_t *buf);
 void hashsig_store_le16 (uint8_t *buf, uint16_t v);
 void hashsig_store_le32 (uint8_t *buf, uint32_t v);
 void hashsig_store_le64 (uint8_t *buf, uint64_t v);
+uint32_t hashsig_load_be32 (const uint8_t *buf);
+void hashsig_store_be32 (uint8_t *buf, uint32_t v);
+void hashsig_store_be64 (uint8_t *buf, uint64_t v);
 void hashsig_assert_ctx (hashsig_t *ctx);
 
+/* CPU features for the runtime selection of optimized code paths. */
+#define HASHSIG_CPU_AVX2    0x01
+#define HASHSIG_CPU_AVX512F 0x02
+#define HASHSIG_CPU_SHA     0x04
+#define HASHSIG_CPU_BMI1    0x08
+#define HASHSIG_CPU_BMI2    0x10
+
+/* Returns non-zero if all of the given features are supported by the CPU. */
+int hashsig_cpu_supports (const int features);
+
 #endif
@@ -0,0 +1,155 @@
+/******************************************************************************
+ * libhashsig - A hash-based digital signature library
+ *
+ * Copyright (c) 2014, Arne Bochem
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the library nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/* Streaming verification */
+
+#include <string.h>
+
+#include "backend.h"
+#include "hashsig_defs.h"
+#include "hashsig.h"
+#include "ldwm_defs.h"
+#include "lmfs_defs.h"
+#include "util.h"
+
+#define HASHSIG_VERIFIER_MESSAGE   0
+#define HASHSIG_VERIFIER_SIGNATURE 1
+
+/* Only one signature segment is buffered at a time. The context has no scratch buffers, which are not needed for verification. */
+struct hashsig_verifier_s
+{
+  hashsig_t ctx;
+  void *sighash_ctx;
+  uint8_t pub[LDWM_N];
+  uint8_t hash[LMFS_HASH_BYTES];
+  uint8_t last[LDWM_N];
+  uint8_t segment[LMFS_SEG_LEN];
+  size_t fill;
+  size_t trees;
+  int phase;
+  int status;
+};
+
+hashsig_verifier_t *hashsig_verifier_create (const hashsig_pub_view_t *pub)
+{
+  const hashsig_backend_t *backend = hashsig_backend(pub->type);
+  hashsig_verifier_t *verifier;
+
+  if (backend == NULL || pub->type > 0xff || (pub->type & ~HASHSIG_FAMILY_MASK) != LMFS_TYPE_PARAMS || pub->len != LDWM_N + 1)
+    return NULL;
+
+  verifier = hashsig_alloc(NULL, sizeof(hashsig_verifier_t), sizeof(uint64_t));
+  verifier->ctx.backend = backend;
+  verifier->ctx.hash_ctx = hashsig_alloc(NULL, backend->ctx_size, 64);
+  verifier->ctx.pub = verifier->pub;
+  verifier->ctx.type = pub->type;
+  verifier->sighash_ctx = hashsig_alloc(NULL, backend->ctx_size, 64);
+  memcpy(verifier->pub, pub->data, LDWM_N);
+
+  backend->sighash_init(verifier->sighash_ctx, LMFS_HASH_BYTES, verifier->pub, LDWM_N);
+
+  return verifier;
+}
+
+void hashsig_verifier_message (hashsig_verifier_t *verifier, const uint8_t *data, const size_t len)
+{
+  /* The message has to come before the signature. */
+  if (verifier->phase != HASHSIG_VERIFIER_MESSAGE)
+  {
+    verifier->status = 1;
+    return;
+  }
+
+  verifier->ctx.backend->sighash_update(verifier->sighash_ctx, data, len);
+}
+
+int hashsig_verifier_signature (hashsig_verifier_t *verifier, const uint8_t *data, size_t len)
+{
+  size_t n;
+
+  if (len == 0 || verifier->status)
+    return verifier->status;
+
+  /* The message is complete. Set its hash up as the first value to be verified and check the signature header. */
+  if (verifier->phase == HASHSIG_VERIFIER_MESSAGE)
+  {
+    verifier->ctx.backend->sighash_final(verifier->sighash_ctx, verifier->hash);
+    memcpy(verifier->last, verifier->hash, LDWM_N);
+    verifier->phase = HASHSIG_VERIFIER_SIGNATURE;
+
+    if (data[0] != verifier->ctx.type)
+      return verifier->status = -1;
+    data += LMFS_SIG_HEADER;
+    len -= LMFS_SIG_HEADER;
+  }
+
+  while (len > 0)
+  {
+    if (verifier->trees == LMFS_TREES)
+      return verifier->status = 1;
+
+    n = LMFS_SEG_LEN - verifier->fill;
+    if (n > len)
+      n = len;
+    memcpy(verifier->segment + verifier->fill, data, n);
+    verifier->fill += n;
+    data += n;
+    len -= n;
+
+    /* Verify each segment once complete, starting at the deepest level. */
+    if (verifier->fill == LMFS_SEG_LEN)
+    {
+      if (hashsig_lmfs_verify_segment(&verifier->ctx, verifier->segment, verifier->hash, verifier->last, LMFS_TREES - 1 - verifier->trees))
+        return verifier->status = 1;
+      verifier->fill = 0;
+      verifier->trees++;
+    }
+  }
+
+  return 0;
+}
+
+int hashsig_verifier_final (hashsig_verifier_t *verifier)
+{
+  if (verifier->status)
+    return verifier->status;
+
+  /* If the root of the top tree is the public key, the signature is valid. */
+  if (verifier->trees != LMFS_TREES || memcmp(verifier->last, verifier->pub, LDWM_N))
+    return 1;
+
+  return 0;
+}
+
+void hashsig_verifier_free (hashsig_verifier_t *verifier)
+{
+  hashsig_dealloc(NULL, verifier->sighash_ctx, verifier->ctx.backend->ctx_size);
+  hashsig_dealloc(NULL, verifier->ctx.hash_ctx, verifier->ctx.backend->ctx_size);
+  hashsig_dealloc(NULL, verifier, sizeof(hashsig_verifier_t));
+}